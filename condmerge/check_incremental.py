@@ -0,0 +1,159 @@
+# <legal>
+# DMC Tool
+# Copyright 2023 Carnegie Mellon University.
+# 
+# NO WARRANTY. THIS CARNEGIE MELLON UNIVERSITY AND SOFTWARE ENGINEERING INSTITUTE
+# MATERIAL IS FURNISHED ON AN "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO
+# WARRANTIES OF ANY KIND, EITHER EXPRESSED OR IMPLIED, AS TO ANY MATTER
+# INCLUDING, BUT NOT LIMITED TO, WARRANTY OF FITNESS FOR PURPOSE OR
+# MERCHANTABILITY, EXCLUSIVITY, OR RESULTS OBTAINED FROM USE OF THE MATERIAL.
+# CARNEGIE MELLON UNIVERSITY DOES NOT MAKE ANY WARRANTY OF ANY KIND WITH RESPECT
+# TO FREEDOM FROM PATENT, TRADEMARK, OR COPYRIGHT INFRINGEMENT.
+# 
+# Released under a MIT (SEI)-style license, please see License.txt or contact
+# permission@sei.cmu.edu for full terms.
+# 
+# [DISTRIBUTION STATEMENT A] This material has been approved for public release
+# and unlimited distribution.  Please see Copyright notice for non-US Government
+# use and distribution.
+# 
+# Carnegie Mellon (R) and CERT (R) are registered in the U.S. Patent and Trademark
+# Office by Carnegie Mellon University.
+# 
+# This Software includes and/or makes use of the following Third-Party Software
+# subject to its own license:
+# 1. Phasar
+#     (https://github.com/secure-software-engineering/phasar/blob/development/LICENSE.txt)
+#     Copyright 2017 - 2023 Philipp Schubert and others.  
+# 2. LLVM (https://github.com/llvm/llvm-project/blob/main/LICENSE.TXT) 
+#     Copyright 2003 - 2022 LLVM Team.
+# 
+# DM23-0532
+# </legal>
+
+
+# Checks that -incremental gives the output of a full run.  Synthetic
+# modules are generated by gen_bench.py, with globals shared by many
+# functions and recursion; the pass saves its summaries of each module, and
+# each edit of each function (a call replaced by a pointer into an argument,
+# a store to a global dropped or added, another returned value) is then
+# analyzed both from scratch and from the saved summaries.  Any difference
+# of the flows is reported and makes the exit status nonzero.  Run by "make
+# test" (ctest) in the build directory.
+
+import os
+import re
+import sys
+import shutil
+import argparse
+import tempfile
+import subprocess
+from pathlib import Path
+
+import gen_bench
+
+REPO_DIR = Path(__file__).resolve().parent.parent
+
+# gen_bench.py parameters of the modules, over its defaults
+MODULES = [
+    ["--funcs", "60", "--depth", "4", "--globals", "3", "--sharing", "0.3", "--recursion", "0.2", "--seed", "3"],
+    ["--funcs", "80", "--depth", "5", "--scc-size", "2", "--globals", "4", "--sharing", "0.2", "--seed", "7"],
+]
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Checks that -incremental gives the output of a full run')
+    parser.add_argument("--lib", type=str, default="/host_dmc/condmerge/libTaint.so", help="The taint pass plugin")
+    parser.add_argument("--llvm-version", type=int, default=int(os.environ.get("CLANGVER", "14")),
+                        help="LLVM version of opt (default $CLANGVER)")
+    parser.add_argument("--pass-args", type=str, default="", help="More arguments for the pass, e.g. '-taint-threads=4'")
+    parser.add_argument("--max-edits", type=int, default=None, help="Edits to check per module (default all)")
+    global cmdline_args
+    cmdline_args = parser.parse_args()
+    return cmdline_args
+
+# As run_taint_pass.sh
+def pass_command(ll_file, wrappers_file, more_args):
+    args = cmdline_args
+    if args.llvm_version < 17:
+        cmd = ["opt-%d" % (args.llvm_version,), "-enable-new-pm=0", "-load", args.lib, "-mem2reg", "-taint"]
+    else:
+        cmd = ["opt", "-load-pass-plugin=" + args.lib, "-passes=function(mem2reg),taint"]
+    cmd += ["-o", "/dev/null", ll_file,
+            "--sources-and-sinks", str(REPO_DIR / "gpt" / "func_taint3.txt"),
+            "--taint-copiers", str(REPO_DIR / "taint_copiers.txt"),
+            "--wrappers", wrappers_file]
+    return cmd + args.pass_args.split() + list(more_args)
+
+# Returns the flows printed by the pass
+def run_pass(ll_file, wrappers_file, more_args=()):
+    return subprocess.run(pass_command(ll_file, wrappers_file, more_args), check=True,
+                          stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, text=True).stdout
+
+# Returns the function bodies of the module, as (name, start, end) offsets
+def function_bodies(module):
+    bodies = []
+    for m in re.finditer(r"^define [^@]*@(f\d+)\(.*\n", module, re.M):
+        bodies.append((m.group(1), m.end(), module.index("\n}", m.end())))
+    return bodies
+
+# Returns the edits of one function body, as (kind, new body); the kinds
+# that don't apply to the body are left out
+def edits_of(body, ptr):
+    edits = []
+    call = re.search(r"(%%t\d+) = call %s @f\d+\(%s (%%\w+)," % (re.escape(ptr), re.escape(ptr)), body)
+    if call:
+        gep = "%s = getelementptr i8, %s %s, i64 1" % (call.group(1), ptr, call.group(2))
+        edits.append(("call", body[:call.start()] + gep + body[body.index("\n", call.end()):]))
+    store = re.search(r"\n  store .* @g\d+(?=\n)", body)
+    if store:
+        edits.append(("unstore", body[:store.start()] + body[store.end():]))
+    ret = body.rindex("\n  %c = icmp")
+    edits.append(("store", body[:ret] + "\n  store %s %%a, %s* @g0" % (ptr, ptr) + body[ret:]))
+    edits.append(("ret", re.sub(r"ret %s %%r" % (re.escape(ptr),), "ret %s %%b" % (ptr,), body)))
+    return edits
+
+# Returns the number of edits whose incremental flows differ
+def check_module(work_dir, ix_module, gen_args):
+    parser = argparse.ArgumentParser()
+    gen_bench.add_params(parser)
+    params = parser.parse_args(gen_args)
+    params.opaque_pointers = cmdline_args.llvm_version >= 17
+    ptr = "ptr" if params.opaque_pointers else "i8*"
+    ll_file = os.path.join(work_dir, "module%d.ll" % (ix_module,))
+    wrappers_file = os.path.join(work_dir, "module%d.wrappers.txt" % (ix_module,))
+    saved_file = os.path.join(work_dir, "module%d.incremental" % (ix_module,))
+    inc_file = os.path.join(work_dir, "incremental")
+    edited_file = os.path.join(work_dir, "edited.ll")
+    gen_bench.generate(params, ll_file, wrappers_file)
+    run_pass(ll_file, wrappers_file, ["-incremental", saved_file])
+    with open(ll_file, "rt") as f:
+        module = f.read()
+    num_failed = 0
+    num_edits = 0
+    for name, start, end in function_bodies(module):
+        for kind, body in edits_of(module[start:end], ptr):
+            if cmdline_args.max_edits is not None and num_edits >= cmdline_args.max_edits:
+                break
+            num_edits += 1
+            with open(edited_file, "wt") as f:
+                f.write(module[:start] + body + module[end:])
+            full = run_pass(edited_file, wrappers_file)
+            # Each run rewrites the file
+            shutil.copyfile(saved_file, inc_file)
+            incremental = run_pass(edited_file, wrappers_file, ["-incremental", inc_file])
+            if incremental != full:
+                num_failed += 1
+                print("  %s of %s: the flows differ from a full run" % (kind, name))
+    print("module%d: %d edits, %s" % (ix_module, num_edits, "%d FAILED" % (num_failed,) if num_failed else "ok"))
+    return num_failed
+
+def main():
+    parse_args()
+    num_failed = 0
+    with tempfile.TemporaryDirectory() as work_dir:
+        for ix_module, gen_args in enumerate(MODULES):
+            num_failed += check_module(work_dir, ix_module, gen_args)
+    if num_failed:
+        sys.exit(1)
+
+main()
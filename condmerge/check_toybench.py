@@ -0,0 +1,204 @@
+# <legal>
+# DMC Tool
+# Copyright 2023 Carnegie Mellon University.
+# 
+# NO WARRANTY. THIS CARNEGIE MELLON UNIVERSITY AND SOFTWARE ENGINEERING INSTITUTE
+# MATERIAL IS FURNISHED ON AN "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO
+# WARRANTIES OF ANY KIND, EITHER EXPRESSED OR IMPLIED, AS TO ANY MATTER
+# INCLUDING, BUT NOT LIMITED TO, WARRANTY OF FITNESS FOR PURPOSE OR
+# MERCHANTABILITY, EXCLUSIVITY, OR RESULTS OBTAINED FROM USE OF THE MATERIAL.
+# CARNEGIE MELLON UNIVERSITY DOES NOT MAKE ANY WARRANTY OF ANY KIND WITH RESPECT
+# TO FREEDOM FROM PATENT, TRADEMARK, OR COPYRIGHT INFRINGEMENT.
+# 
+# Released under a MIT (SEI)-style license, please see License.txt or contact
+# permission@sei.cmu.edu for full terms.
+# 
+# [DISTRIBUTION STATEMENT A] This material has been approved for public release
+# and unlimited distribution.  Please see Copyright notice for non-US Government
+# use and distribution.
+# 
+# Carnegie Mellon (R) and CERT (R) are registered in the U.S. Patent and Trademark
+# Office by Carnegie Mellon University.
+# 
+# This Software includes and/or makes use of the following Third-Party Software
+# subject to its own license:
+# 1. Phasar
+#     (https://github.com/secure-software-engineering/phasar/blob/development/LICENSE.txt)
+#     Copyright 2017 - 2023 Philipp Schubert and others.  
+# 2. LLVM (https://github.com/llvm/llvm-project/blob/main/LICENSE.TXT) 
+#     Copyright 2003 - 2022 LLVM Team.
+# 
+# DM23-0532
+# </legal>
+
+
+# Checks the taint pass over the toybench programs: each program is compiled
+# as in the README, the pass is run on it (with its wrappers file, if any)
+# and its flows are connected by connect_flows.py.  The connected flows are
+# compared with the golden <program>.flows checked in next to the program,
+# which every program must have; --update-goldens writes those instead.  With --baseline, the wall time
+# and the peak RSS of the pass are also compared with the ones recorded in
+# that (machine-local) directory by --record.  Any change of the flows, or
+# time or memory beyond the tolerance, is reported and makes the exit status
+# nonzero.  Run by "make test" (ctest) in the build directory.
+
+import os
+import sys
+import json
+import time
+import difflib
+import argparse
+import tempfile
+import subprocess
+from pathlib import Path
+
+REPO_DIR = Path(__file__).resolve().parent.parent
+
+# Wrappers files not named <program>.wrappers.txt
+WRAPPERS_FILES = {"mal-client-2": "mc2.wrappers.txt"}
+
+# More arguments of the pass for some programs
+PASS_ARGS = {"prune01": ["-demand-driven", "-taint-threads=4"]}
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Checks the taint pass against golden flows over the toybench programs')
+    parser.add_argument("--update-goldens", action="store_true",
+                        help="Write the golden flows instead of checking against them")
+    parser.add_argument("--baseline", type=str, default=None, help="Directory of the time and memory baseline")
+    parser.add_argument("--record", action="store_true",
+                        help="Record the time and memory baseline instead of checking against it")
+    parser.add_argument("--lib", type=str, default="/host_dmc/condmerge/libTaint.so", help="The taint pass plugin")
+    parser.add_argument("--llvm-version", type=int, default=int(os.environ.get("CLANGVER", "14")),
+                        help="LLVM version of clang and opt (default $CLANGVER)")
+    parser.add_argument("--bench-dir", type=str, default=str(REPO_DIR / "toybench"), help="Directory of the programs")
+    parser.add_argument("--no-compile", action="store_true", help="Use the .ll files already next to the programs")
+    parser.add_argument("--tolerance", type=float, default=0.5,
+                        help="Allowed increase of time and memory over the baseline, as a fraction (default 0.5)")
+    parser.add_argument("--min-time", type=float, default=0.2,
+                        help="Time increases below this many seconds are never reported (default 0.2)")
+    parser.add_argument("--pass-args", type=str, default="", help="More arguments for the pass")
+    global cmdline_args
+    cmdline_args = parser.parse_args()
+    return cmdline_args
+
+def compile_program(c_file, work_dir):
+    ll_file = os.path.join(work_dir, Path(c_file).stem + ".ll")
+    cmd = ["clang-%d" % (cmdline_args.llvm_version,), "-Xclang", "-disable-O0-optnone", "-fno-discard-value-names",
+           "-fno-inline-functions", "-ggdb", "-c", "-S", "-emit-llvm", "-O0", c_file, "-o", ll_file]
+    # From the program's directory, so that the debug info has the same
+    # filenames as when compiled by hand
+    subprocess.run(cmd, cwd=os.path.dirname(c_file), check=True)
+    return ll_file
+
+# As run_taint_pass.sh
+def pass_command(ll_file, wrappers_file, name):
+    args = cmdline_args
+    if args.llvm_version < 17:
+        cmd = ["opt-%d" % (args.llvm_version,), "-enable-new-pm=0", "-load", args.lib, "-mem2reg", "-taint"]
+    else:
+        cmd = ["opt", "-load-pass-plugin=" + args.lib, "-passes=function(mem2reg),taint"]
+    cmd += ["-o", "/dev/null", ll_file,
+            "--sources-and-sinks", str(REPO_DIR / "gpt" / "func_taint3.txt"),
+            "--taint-copiers", str(REPO_DIR / "taint_copiers.txt")]
+    if wrappers_file:
+        cmd += ["--wrappers", wrappers_file]
+    return cmd + PASS_ARGS.get(name, []) + args.pass_args.split()
+
+# Returns {flows, wall, peak_rss_kb} of one program
+def run_case(c_file, work_dir):
+    name = Path(c_file).stem
+    if cmdline_args.no_compile:
+        ll_file = os.path.join(os.path.dirname(c_file), name + ".ll")
+    else:
+        ll_file = compile_program(c_file, work_dir)
+    wrappers_file = os.path.join(os.path.dirname(c_file), WRAPPERS_FILES.get(name, name + ".wrappers.txt"))
+    if not os.path.exists(wrappers_file):
+        wrappers_file = None
+    raw_file = os.path.join(work_dir, name + ".raw.txt")
+    start = time.perf_counter()
+    with open(raw_file, "wb") as raw:
+        proc = subprocess.Popen(pass_command(ll_file, wrappers_file, name), stdout=raw, stderr=subprocess.DEVNULL)
+        _, status, rusage = os.wait4(proc.pid, 0)
+    wall = time.perf_counter() - start
+    if os.waitstatus_to_exitcode(status) != 0:
+        raise RuntimeError("the pass failed on " + ll_file)
+    flows = subprocess.run([sys.executable, str(REPO_DIR / "condmerge" / "connect_flows.py"), raw_file],
+                           check=True, stdout=subprocess.PIPE, text=True).stdout
+    return {"flows": flows, "wall": wall, "peak_rss_kb": rusage.ru_maxrss}
+
+# Returns the problems of one program
+def check_case(name, result, baseline):
+    args = cmdline_args
+    problems = []
+    golden_file = os.path.join(args.bench_dir, name + ".flows")
+    if not os.path.exists(golden_file):
+        problems.append("no golden flows (%s.flows); write them with --update-goldens" % (name,))
+    else:
+        with open(golden_file, "rt") as f:
+            expected = f.read()
+        if result["flows"] != expected:
+            diff = difflib.unified_diff(expected.splitlines(True), result["flows"].splitlines(True),
+                                        name + ".flows (golden)", name + ".flows")
+            problems.append("flows differ:\n" + "".join(diff))
+    if baseline is None:
+        return problems
+    if name not in baseline:
+        problems.append("not in the time and memory baseline")
+        return problems
+    base = baseline[name]
+    if result["wall"] > base["wall"] * (1 + args.tolerance) and result["wall"] - base["wall"] > args.min_time:
+        problems.append("time %.3fs, baseline %.3fs" % (result["wall"], base["wall"]))
+    if result["peak_rss_kb"] > base["peak_rss_kb"] * (1 + args.tolerance):
+        problems.append("peak RSS %d KB, baseline %d KB" % (result["peak_rss_kb"], base["peak_rss_kb"]))
+    return problems
+
+def main():
+    args = parse_args()
+    if args.record and args.baseline is None:
+        sys.exit("--record needs --baseline")
+    c_files = sorted(str(p) for p in Path(args.bench_dir).glob("*.c"))
+    baseline = None
+    if args.baseline is not None:
+        baseline_file = os.path.join(args.baseline, "baseline.json")
+        if args.record:
+            os.makedirs(args.baseline, exist_ok=True)
+            baseline = {}
+        else:
+            with open(baseline_file, "rt") as f:
+                baseline = json.load(f)
+    num_failed = 0
+    with tempfile.TemporaryDirectory() as work_dir:
+        for c_file in c_files:
+            name = Path(c_file).stem
+            try:
+                result = run_case(c_file, work_dir)
+            except (RuntimeError, subprocess.CalledProcessError) as e:
+                print("%-20s FAILED\n  %s" % (name, e))
+                num_failed += 1
+                continue
+            notes = "%.3fs, %d KB" % (result["wall"], result["peak_rss_kb"])
+            if args.update_goldens:
+                with open(os.path.join(args.bench_dir, name + ".flows"), "wt") as f:
+                    f.write(result["flows"])
+                notes += ", golden flows written"
+            if args.record:
+                baseline[name] = {"wall": result["wall"], "peak_rss_kb": result["peak_rss_kb"]}
+                print("%-20s recorded (%s)" % (name, notes))
+                continue
+            problems = check_case(name, result, baseline)
+            if problems:
+                num_failed += 1
+                print("%-20s FAILED" % (name,))
+                for problem in problems:
+                    print("  " + problem)
+            else:
+                print("%-20s ok (%s)" % (name, notes))
+    if args.record:
+        with open(baseline_file, "wt") as f:
+            json.dump(baseline, f, indent=1, sort_keys=True)
+            f.write("\n")
+    if num_failed:
+        print("%d of %d programs failed" % (num_failed, len(c_files)))
+        sys.exit(1)
+
+main()
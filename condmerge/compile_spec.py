@@ -0,0 +1,282 @@
+# <legal>
+# DMC Tool
+# Copyright 2023 Carnegie Mellon University.
+# 
+# NO WARRANTY. THIS CARNEGIE MELLON UNIVERSITY AND SOFTWARE ENGINEERING INSTITUTE
+# MATERIAL IS FURNISHED ON AN "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO
+# WARRANTIES OF ANY KIND, EITHER EXPRESSED OR IMPLIED, AS TO ANY MATTER
+# INCLUDING, BUT NOT LIMITED TO, WARRANTY OF FITNESS FOR PURPOSE OR
+# MERCHANTABILITY, EXCLUSIVITY, OR RESULTS OBTAINED FROM USE OF THE MATERIAL.
+# CARNEGIE MELLON UNIVERSITY DOES NOT MAKE ANY WARRANTY OF ANY KIND WITH RESPECT
+# TO FREEDOM FROM PATENT, TRADEMARK, OR COPYRIGHT INFRINGEMENT.
+# 
+# Released under a MIT (SEI)-style license, please see License.txt or contact
+# permission@sei.cmu.edu for full terms.
+# 
+# [DISTRIBUTION STATEMENT A] This material has been approved for public release
+# and unlimited distribution.  Please see Copyright notice for non-US Government
+# use and distribution.
+# 
+# Carnegie Mellon (R) and CERT (R) are registered in the U.S. Patent and Trademark
+# Office by Carnegie Mellon University.
+# 
+# This Software includes and/or makes use of the following Third-Party Software
+# subject to its own license:
+# 1. Phasar
+#     (https://github.com/secure-software-engineering/phasar/blob/development/LICENSE.txt)
+#     Copyright 2017 - 2023 Philipp Schubert and others.  
+# 2. LLVM (https://github.com/llvm/llvm-project/blob/main/LICENSE.TXT) 
+#     Copyright 2003 - 2022 LLVM Team.
+# 
+# DM23-0532
+# </legal>
+
+# Compiles a sources-and-sinks file and a taint-copiers file into a spec
+# database, which the taint pass reads (mmap'ed) with -spec-db=FILE instead
+# of parsing the text files on every run.  The files are validated here,
+# once; errors that depend on the program analyzed (e.g., too many
+# arguments) are still reported by the pass.
+#
+# The database is a header, of the magic "DMCS", the version, the number of
+# lines of the sources-and-sinks file, and the (offset, count) of each
+# section below, followed by the sections.  Every field is a little-endian
+# uint32 at a 4-byte aligned offset.
+#   spec displacements, spec slots:   perfect hash of the spec names
+#   spec entries:     {name, first record, number of records (lines)}
+#   spec records:     {return category, first argument category, count}
+#   copier displacements, copier slots: perfect hash of the copier names
+#   copier entries:   {name, first edge, number of edges}
+#   copier edges:     {sink argument, source argument}, RETVAL_CODE is -1
+#   string offsets:   count+1 offsets into the string data
+#   string data
+#   argument categories: one byte per argument, padded
+# A name hashes to the bucket hash_name(name, 0) % #displacements, and to
+# the slot hash_name(name, displacement of its bucket) % #slots, which holds
+# the index of its entry (or NONE); the entry's name must be compared.  An
+# argument category is 0 for "-", or CAT_PRESENT | CAT_SRC | CAT_SINK |
+# CAT_FILE, as in the text.
+
+import sys
+import struct
+import argparse
+
+MAGIC = b"DMCS"
+VERSION = 1
+NONE = 0xffffffff
+NUM_SECTIONS = 11
+
+CAT_SRC = 1
+CAT_SINK = 2
+CAT_FILE = 4
+CAT_PRESENT = 8
+
+RETVAL_CODE = -1
+
+class SpecError(Exception):
+    pass
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Compiles the taint pass spec files into a spec database')
+    parser.add_argument("sources_and_sinks", type=str, help="Sources-and-sinks file, as for --sources-and-sinks")
+    parser.add_argument("taint_copiers", type=str, help="Taint-copiers file, as for --taint-copiers")
+    parser.add_argument('-o', type=str, dest="out_file", required=True, help="Output file")
+    global cmdline_args
+    cmdline_args = parser.parse_args()
+    return cmdline_args
+
+def read_lines(filename):
+    with open(filename, 'rt') as f:
+        lines = f.read().split('\n')
+    if lines and lines[-1] == '':
+        lines.pop()
+    return lines
+
+def parse_category(cat, where):
+    flags = CAT_PRESENT
+    if cat.startswith("File"):
+        cat = cat[4:]
+        flags |= CAT_FILE
+    if cat == "Src":
+        flags |= CAT_SRC
+    elif cat == "Sink":
+        flags |= CAT_SINK
+    elif cat == "SrcAndSink":
+        flags |= CAT_SRC | CAT_SINK
+    elif cat != "none":
+        raise SpecError("%s: unrecognized category '%s'" % (where, cat))
+    return flags
+
+# As populate_sources_and_sinks_2 in taint.cpp: the name, then a category per
+# argument ("-" for none), then "->" and the category of the return value.
+# Returns {name: [(return category, [argument categories])]}.
+def parse_sources_and_sinks(filename):
+    specs = {}
+    lines = read_lines(filename)
+    for ix_line, line in enumerate(lines):
+        where = "%s:%d" % (filename, ix_line + 1)
+        tokens = line.split()
+        if not tokens:
+            continue
+        name, tokens = tokens[0], tokens[1:]
+        ret_cat = 0
+        arg_cats = []
+        i = 0
+        while i < len(tokens):
+            if tokens[i] == "-":
+                arg_cats.append(0)
+            elif tokens[i] == "->":
+                if i + 2 != len(tokens):
+                    raise SpecError("%s: expected one category after '->'" % (where,))
+                ret_cat = parse_category(tokens[i + 1], where)
+                if ret_cat & CAT_SINK:
+                    raise SpecError("%s: %s: return value cannot be a sink" % (where, name))
+                break
+            else:
+                arg_cats.append(parse_category(tokens[i], where))
+            i += 1
+        specs.setdefault(name, []).append((ret_cat, arg_cats))
+    return specs, len(lines)
+
+# As parse_taint_cp_file in taint.cpp: "name ( arg -> [ flows , ... ] , ... )",
+# where an argument's taint flows into the listed arguments.  Returns
+# {name: [(sink argument, source argument)]}.
+def parse_taint_copiers(filename):
+    copiers = {}
+    for ix_line, line in enumerate(read_lines(filename)):
+        where = "%s:%d" % (filename, ix_line + 1)
+        if not line.strip():
+            continue
+        pos, lpos, rpos = line.find(" "), line.find("("), line.find(")")
+        if pos < 0 or lpos < 0 or rpos < 0:
+            raise SpecError("%s: formatted incorrectly" % (where,))
+        name = line[:pos]
+        args = line[lpos + 2:rpos - 1]
+        arg_list = []
+        while (pos := args.find(" ]")) >= 0:
+            s = args[:pos + 2]
+            if s.startswith(","):
+                s = s[2:]
+            args = args[pos + 2:]
+            arg_name, sep, flow = s.partition(" -> ")
+            if not sep or "[ " not in flow or " ]" not in flow:
+                raise SpecError("%s: '%s' formatted incorrectly" % (where, s))
+            flows = flow[2:-2].split(" , ") if len(flow) > 3 else []
+            arg_list.append((arg_name, flows))
+        ix_of_arg = {"return": RETVAL_CODE}
+        for ix, (arg_name, _) in enumerate(arg_list):
+            ix_of_arg[arg_name] = ix
+        edges = []
+        for ix, (_, flows) in enumerate(arg_list):
+            for flow_name in flows:
+                if flow_name not in ix_of_arg:
+                    raise SpecError("%s: %s: unknown argument '%s'" % (where, name, flow_name))
+                edges.append((ix_of_arg[flow_name], ix))
+        copiers[name] = edges
+    return copiers
+
+# FNV-1a, with MurmurHash3's finalizer so that the low bits depend on the
+# seed (hashName in taint.cpp).
+def hash_name(data, seed):
+    h = 2166136261 ^ seed
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xffffffff
+    h ^= h >> 16
+    h = (h * 0x85ebca6b) & 0xffffffff
+    h ^= h >> 13
+    h = (h * 0xc2b2ae35) & 0xffffffff
+    h ^= h >> 16
+    return h
+
+# Hash-and-displace: the buckets are placed largest first, each with the
+# first displacement that sends all its names to free slots.
+def perfect_hash(names):
+    names = [name.encode() for name in names]
+    num_buckets = max(1, len(names) // 4)
+    num_slots = max(1, len(names) + len(names) // 4)
+    buckets = [[] for _ in range(num_buckets)]
+    for ix, name in enumerate(names):
+        buckets[hash_name(name, 0) % num_buckets].append(ix)
+    displacements = [0] * num_buckets
+    slots = [NONE] * num_slots
+    for ix_bucket in sorted(range(num_buckets), key=lambda b: -len(buckets[b])):
+        bucket = buckets[ix_bucket]
+        if not bucket:
+            break
+        d = 1
+        while True:
+            wanted = [hash_name(names[ix], d) % num_slots for ix in bucket]
+            if len(set(wanted)) == len(wanted) and all(slots[s] == NONE for s in wanted):
+                break
+            d += 1
+        displacements[ix_bucket] = d
+        for ix, s in zip(bucket, wanted):
+            slots[s] = ix
+    return displacements, slots
+
+def compile_spec(specs, num_spec_lines, copiers):
+    strings = []
+    string_ids = {}
+    def string(s):
+        if s not in string_ids:
+            string_ids[s] = len(strings)
+            strings.append(s.encode())
+        return string_ids[s]
+
+    spec_names = sorted(specs)
+    spec_entries, spec_records, arg_bytes = [], [], bytearray()
+    for name in spec_names:
+        spec_entries += [string(name), len(spec_records) // 3, len(specs[name])]
+        for ret_cat, arg_cats in specs[name]:
+            spec_records += [ret_cat, len(arg_bytes), len(arg_cats)]
+            arg_bytes += bytes(arg_cats)
+    copier_names = sorted(copiers)
+    copier_entries, copier_edges = [], []
+    for name in copier_names:
+        copier_entries += [string(name), len(copier_edges) // 2, len(copiers[name])]
+        for sink, src in copiers[name]:
+            copier_edges += [sink & 0xffffffff, src & 0xffffffff]
+    spec_disp, spec_slots = perfect_hash(spec_names)
+    copier_disp, copier_slots = perfect_hash(copier_names)
+
+    str_offsets = [0]
+    for s in strings:
+        str_offsets.append(str_offsets[-1] + len(s))
+    str_data = b"".join(strings)
+    str_data += b"\0" * (-len(str_data) % 4)
+    arg_bytes += b"\0" * (-len(arg_bytes) % 4)
+
+    def words(ws):
+        return struct.pack("<%dI" % (len(ws),), *ws)
+    sections = [
+        (words(spec_disp), len(spec_disp)),
+        (words(spec_slots), len(spec_slots)),
+        (words(spec_entries), len(spec_names)),
+        (words(spec_records), len(spec_records) // 3),
+        (words(copier_disp), len(copier_disp)),
+        (words(copier_slots), len(copier_slots)),
+        (words(copier_entries), len(copier_names)),
+        (words(copier_edges), len(copier_edges) // 2),
+        (words(str_offsets), len(strings)),
+        (str_data, str_offsets[-1]),
+        (bytes(arg_bytes), len(arg_bytes)),
+    ]
+    header = [VERSION, num_spec_lines]
+    offset = 4 + 4 * (len(header) + 2 * NUM_SECTIONS)
+    for data, count in sections:
+        header += [offset, count]
+        offset += len(data)
+    return MAGIC + words(header) + b"".join(data for data, _ in sections)
+
+def main():
+    parse_args()
+    try:
+        specs, num_spec_lines = parse_sources_and_sinks(cmdline_args.sources_and_sinks)
+        copiers = parse_taint_copiers(cmdline_args.taint_copiers)
+    except SpecError as e:
+        print("Error: %s" % (e,), file=sys.stderr)
+        sys.exit(1)
+    with open(cmdline_args.out_file, "wb") as outf:
+        outf.write(compile_spec(specs, num_spec_lines, copiers))
+    print("Compiled %d sources and sinks and %d taint copiers" % (len(specs), len(copiers)))
+
+main()
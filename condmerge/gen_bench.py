@@ -0,0 +1,256 @@
+# <legal>
+# DMC Tool
+# Copyright 2023 Carnegie Mellon University.
+# 
+# NO WARRANTY. THIS CARNEGIE MELLON UNIVERSITY AND SOFTWARE ENGINEERING INSTITUTE
+# MATERIAL IS FURNISHED ON AN "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO
+# WARRANTIES OF ANY KIND, EITHER EXPRESSED OR IMPLIED, AS TO ANY MATTER
+# INCLUDING, BUT NOT LIMITED TO, WARRANTY OF FITNESS FOR PURPOSE OR
+# MERCHANTABILITY, EXCLUSIVITY, OR RESULTS OBTAINED FROM USE OF THE MATERIAL.
+# CARNEGIE MELLON UNIVERSITY DOES NOT MAKE ANY WARRANTY OF ANY KIND WITH RESPECT
+# TO FREEDOM FROM PATENT, TRADEMARK, OR COPYRIGHT INFRINGEMENT.
+# 
+# Released under a MIT (SEI)-style license, please see License.txt or contact
+# permission@sei.cmu.edu for full terms.
+# 
+# [DISTRIBUTION STATEMENT A] This material has been approved for public release
+# and unlimited distribution.  Please see Copyright notice for non-US Government
+# use and distribution.
+# 
+# Carnegie Mellon (R) and CERT (R) are registered in the U.S. Patent and Trademark
+# Office by Carnegie Mellon University.
+# 
+# This Software includes and/or makes use of the following Third-Party Software
+# subject to its own license:
+# 1. Phasar
+#     (https://github.com/secure-software-engineering/phasar/blob/development/LICENSE.txt)
+#     Copyright 2017 - 2023 Philipp Schubert and others.  
+# 2. LLVM (https://github.com/llvm/llvm-project/blob/main/LICENSE.TXT) 
+#     Copyright 2003 - 2022 LLVM Team.
+# 
+# DM23-0532
+# </legal>
+
+
+# Generates a synthetic LLVM module for benchmarking the taint pass, and the
+# matching wrappers file.  The defined functions are laid out in layers;
+# each calls functions of the next layer, so --depth and --width shape the
+# call graph.  Within a layer, functions are grouped into rings of
+# --scc-size that call each other, and --recursion adds calls back to
+# earlier layers, both making SCCs.  Sources and sinks are libc functions of
+# gpt/func_taint3.txt, called directly or through the wrappers, and globals
+# shared by several functions carry taint between them.  The same
+# parameters and seed give the same module.
+
+import sys
+import random
+import argparse
+
+SOURCES = ["fgets", "getenv"]
+SINKS = ["system", "fputs"]
+
+def add_params(parser):
+    parser.add_argument("--funcs", type=int, default=1000, help="Number of functions (default 1000)")
+    parser.add_argument("--depth", type=int, default=8, help="Number of layers of the call graph (default 8)")
+    parser.add_argument("--width", type=int, default=3, help="Calls from each function to the next layer (default 3)")
+    parser.add_argument("--scc-size", type=int, default=1, help="Functions per ring of mutually recursive functions (default 1, none)")
+    parser.add_argument("--recursion", type=float, default=0.0, help="Probability of a call back to an earlier layer (default 0)")
+    parser.add_argument("--sources", type=float, default=0.1, help="Probability of a function calling a source (default 0.1)")
+    parser.add_argument("--sinks", type=float, default=0.1, help="Probability of a function calling a sink (default 0.1)")
+    parser.add_argument("--wrapper-density", type=float, default=0.2, help="Fraction of the sources and sinks called through wrappers (default 0.2)")
+    parser.add_argument("--globals", type=int, default=None, help="Number of global variables (default funcs/20)")
+    parser.add_argument("--sharing", type=float, default=0.1, help="Probability of a function storing to, and of loading from, a global (default 0.1)")
+    parser.add_argument("--seed", type=int, default=1, help="Random seed (default 1)")
+    parser.add_argument("--opaque-pointers", action="store_true", help="Write 'ptr' instead of typed pointers (for LLVM 17)")
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Generates a synthetic module for benchmarking the taint pass')
+    add_params(parser)
+    parser.add_argument('-o', type=str, dest="out_file", required=True, help="Output .ll file")
+    parser.add_argument('--wrappers-file', type=str, help="Output wrappers file, for --wrappers")
+    global cmdline_args
+    cmdline_args = parser.parse_args()
+    return cmdline_args
+
+class ModuleGen:
+    def __init__(self, params):
+        self.p = params
+        self.rng = random.Random(params.seed)
+        opaque = params.opaque_pointers
+        self.ptr = "ptr" if opaque else "i8*"
+        self.fileptr = "ptr" if opaque else "%struct._IO_FILE*"
+        self.fileptrptr = "ptr" if opaque else "%struct._IO_FILE**"
+        self.ptrptr = "ptr" if opaque else "i8**"
+        self.bufptr = "ptr" if opaque else "[64 x i8]*"
+        self.num_globals = params.globals if params.globals is not None else max(1, params.funcs // 20)
+        # An even number, half of them sources
+        self.num_wrappers = 2 * max(1, params.funcs // 100) if params.wrapper_density > 0 else 0
+        self.layers = self.make_layers()
+
+    # Function indices by layer, as evenly as possible
+    def make_layers(self):
+        n, depth = self.p.funcs, max(1, min(self.p.depth, self.p.funcs))
+        bounds = [n * ix // depth for ix in range(depth + 1)]
+        return [list(range(bounds[ix], bounds[ix + 1])) for ix in range(depth)]
+
+    def declarations(self):
+        ptr, fp = self.ptr, self.fileptr
+        out = []
+        if not self.p.opaque_pointers:
+            out.append("%struct._IO_FILE = type opaque")
+        out.append("@stdin = external global %s" % (fp,))
+        out.append("@stdout = external global %s" % (fp,))
+        for ix in range(self.num_globals):
+            out.append("@g%d = global %s null" % (ix, ptr))
+        out.append("declare %s @fgets(%s, i32, %s)" % (ptr, ptr, fp))
+        out.append("declare %s @getenv(%s)" % (ptr, ptr))
+        out.append("declare i32 @system(%s)" % (ptr,))
+        out.append("declare i32 @fputs(%s, %s)" % (ptr, fp))
+        out.append("declare %s @strcpy(%s, %s)" % (ptr, ptr, ptr))
+        return out
+
+    # Appends a call to a source to body, and returns the tainted value
+    def call_source(self, body, name, arg, tmp):
+        ptr = self.ptr
+        if name == "fgets":
+            body.append("  %s.f = load %s, %s @stdin" % (tmp, self.fileptr, self.fileptrptr))
+            body.append("  %s = call %s @fgets(%s %s, i32 64, %s %s.f)" % (tmp, ptr, ptr, arg, self.fileptr, tmp))
+        else:
+            body.append("  %s = call %s @getenv(%s %s)" % (tmp, ptr, ptr, arg))
+        return tmp
+
+    def call_sink(self, body, name, arg, tmp):
+        ptr = self.ptr
+        if name == "fputs":
+            body.append("  %s.f = load %s, %s @stdout" % (tmp, self.fileptr, self.fileptrptr))
+            body.append("  %s = call i32 @fputs(%s %s, %s %s.f)" % (tmp, ptr, arg, self.fileptr, tmp))
+        else:
+            body.append("  %s = call i32 @system(%s %s)" % (tmp, ptr, arg))
+
+    # Wrapper w calls a source (even w) or a sink (odd w) on its argument.
+    def wrapper(self, ix):
+        ptr = self.ptr
+        body = ["define %s @w%d(%s %%a) {" % (ptr, ix, ptr), "entry:"]
+        if ix % 2 == 0:
+            ret = self.call_source(body, SOURCES[(ix // 2) % len(SOURCES)], "%a", "%t")
+        else:
+            self.call_sink(body, SINKS[(ix // 2) % len(SINKS)], "%a", "%t")
+            ret = "%a"
+        body.append("  ret %s %s" % (ptr, ret))
+        body.append("}")
+        return body
+
+    def callees_of(self, ix_layer, ix_func):
+        rng, p = self.rng, self.p
+        callees = []
+        if ix_layer + 1 < len(self.layers):
+            next_layer = self.layers[ix_layer + 1]
+            callees += [rng.choice(next_layer) for _ in range(p.width)]
+        layer = self.layers[ix_layer]
+        if p.scc_size > 1:
+            pos = ix_func - layer[0]
+            ring_start = pos - pos % p.scc_size
+            ring_len = min(p.scc_size, len(layer) - ring_start)
+            if ring_len > 1:
+                callees.append(layer[0] + ring_start + (pos - ring_start + 1) % ring_len)
+        if rng.random() < p.recursion:
+            earlier = self.layers[rng.randrange(ix_layer + 1)]
+            callees.append(rng.choice(earlier))
+        return callees
+
+    def function(self, ix_layer, ix_func):
+        rng, p, ptr = self.rng, self.p, self.ptr
+        body = ["define %s @f%d(%s %%a, %s %%b) {" % (ptr, ix_func, ptr, ptr), "entry:"]
+        body.append("  %buf = alloca [64 x i8]")
+        body.append("  %%p = getelementptr [64 x i8], %s %%buf, i64 0, i64 0" % (self.bufptr,))
+        vals = ["%a", "%b", "%p"]
+        steps = []
+        steps += [("call", callee) for callee in self.callees_of(ix_layer, ix_func)]
+        if rng.random() < p.sources:
+            steps.append(("source", None))
+        if rng.random() < p.sinks:
+            steps.append(("sink", None))
+        if rng.random() < p.sharing:
+            steps.append(("store", rng.randrange(self.num_globals)))
+        if rng.random() < p.sharing:
+            steps.append(("load", rng.randrange(self.num_globals)))
+        if rng.random() < 0.2:
+            steps.append(("copy", None))
+        rng.shuffle(steps)
+        for ix_step, (kind, arg) in enumerate(steps):
+            tmp = "%%t%d" % (ix_step,)
+            val = rng.choice(vals)
+            through_wrapper = self.num_wrappers > 0 and rng.random() < p.wrapper_density
+            if kind == "call":
+                body.append("  %s = call %s @f%d(%s %s, %s %s)" % (tmp, ptr, arg, ptr, val, ptr, rng.choice(vals)))
+                vals.append(tmp)
+            elif kind in ("source", "sink") and through_wrapper:
+                ix_wrapper = 2 * rng.randrange(self.num_wrappers // 2) + (kind == "sink")
+                body.append("  %s = call %s @w%d(%s %s)" % (tmp, ptr, ix_wrapper, ptr, val))
+                vals.append(tmp)
+            elif kind == "source":
+                vals.append(self.call_source(body, rng.choice(SOURCES), val, tmp))
+            elif kind == "sink":
+                self.call_sink(body, rng.choice(SINKS), val, tmp)
+            elif kind == "store":
+                body.append("  store %s %s, %s @g%d" % (ptr, val, self.ptrptr, arg))
+            elif kind == "load":
+                body.append("  %s = load %s, %s @g%d" % (tmp, ptr, self.ptrptr, arg))
+                vals.append(tmp)
+            elif kind == "copy":
+                body.append("  %s = call %s @strcpy(%s %s, %s %s)" % (tmp, ptr, ptr, val, ptr, rng.choice(vals)))
+                vals.append(tmp)
+        # A branch, so that the returned value merges two paths
+        body.append("  %%c = icmp eq %s %%a, %%b" % (ptr,))
+        body.append("  br i1 %c, label %l1, label %l2")
+        body.append("l1:")
+        body.append("  br label %l3")
+        body.append("l2:")
+        body.append("  br label %l3")
+        body.append("l3:")
+        body.append("  %%r = phi %s [ %s, %%l1 ], [ %s, %%l2 ]" % (ptr, rng.choice(vals), rng.choice(vals)))
+        body.append("  ret %s %%r" % (ptr,))
+        body.append("}")
+        return body
+
+    def main_function(self):
+        ptr = self.ptr
+        body = ["define i32 @main() {", "entry:"]
+        body.append("  %buf = alloca [64 x i8]")
+        body.append("  %%p = getelementptr [64 x i8], %s %%buf, i64 0, i64 0" % (self.bufptr,))
+        for ix_func in self.layers[0]:
+            body.append("  %%r%d = call %s @f%d(%s %%p, %s %%p)" % (ix_func, ptr, ix_func, ptr, ptr))
+        body.append("  ret i32 0")
+        body.append("}")
+        return body
+
+    def generate(self):
+        out = self.declarations()
+        for ix in range(self.num_wrappers):
+            out += self.wrapper(ix)
+        for ix_layer, layer in enumerate(self.layers):
+            for ix_func in layer:
+                out += self.function(ix_layer, ix_func)
+        out += self.main_function()
+        return "\n".join(out) + "\n"
+
+    def wrappers(self):
+        return "".join("w%d\n" % (ix,) for ix in range(self.num_wrappers))
+
+def generate(params, ll_file, wrappers_file=None):
+    gen = ModuleGen(params)
+    with open(ll_file, "wt") as outf:
+        outf.write(gen.generate())
+    if wrappers_file:
+        with open(wrappers_file, "wt") as outf:
+            outf.write(gen.wrappers())
+
+def main():
+    parse_args()
+    if cmdline_args.funcs < 1:
+        print("Error: --funcs must be positive", file=sys.stderr)
+        sys.exit(1)
+    generate(cmdline_args, cmdline_args.out_file, cmdline_args.wrappers_file)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,211 @@
+# <legal>
+# DMC Tool
+# Copyright 2023 Carnegie Mellon University.
+# 
+# NO WARRANTY. THIS CARNEGIE MELLON UNIVERSITY AND SOFTWARE ENGINEERING INSTITUTE
+# MATERIAL IS FURNISHED ON AN "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO
+# WARRANTIES OF ANY KIND, EITHER EXPRESSED OR IMPLIED, AS TO ANY MATTER
+# INCLUDING, BUT NOT LIMITED TO, WARRANTY OF FITNESS FOR PURPOSE OR
+# MERCHANTABILITY, EXCLUSIVITY, OR RESULTS OBTAINED FROM USE OF THE MATERIAL.
+# CARNEGIE MELLON UNIVERSITY DOES NOT MAKE ANY WARRANTY OF ANY KIND WITH RESPECT
+# TO FREEDOM FROM PATENT, TRADEMARK, OR COPYRIGHT INFRINGEMENT.
+# 
+# Released under a MIT (SEI)-style license, please see License.txt or contact
+# permission@sei.cmu.edu for full terms.
+# 
+# [DISTRIBUTION STATEMENT A] This material has been approved for public release
+# and unlimited distribution.  Please see Copyright notice for non-US Government
+# use and distribution.
+# 
+# Carnegie Mellon (R) and CERT (R) are registered in the U.S. Patent and Trademark
+# Office by Carnegie Mellon University.
+# 
+# This Software includes and/or makes use of the following Third-Party Software
+# subject to its own license:
+# 1. Phasar
+#     (https://github.com/secure-software-engineering/phasar/blob/development/LICENSE.txt)
+#     Copyright 2017 - 2023 Philipp Schubert and others.  
+# 2. LLVM (https://github.com/llvm/llvm-project/blob/main/LICENSE.TXT) 
+#     Copyright 2003 - 2022 LLVM Team.
+# 
+# DM23-0532
+# </legal>
+
+# Merges the per-translation-unit summaries written by the taint pass with
+# -tu-summary=FILE into the flows of the whole program, without linking the
+# TUs.  Calls into other TUs appear in those summaries as placeholders: an
+# "ext_in" sink per argument, and "ext_out" sources for the return value and
+# the arguments.  Here they are replaced by the callee's summary, the same
+# way the pass plugs in the summary of a callee in the same TU, and the real
+# sources reaching each real sink are printed in the same format as the
+# pass's "FULL FLOWS" section, for connect_flows.py.
+
+import sys
+import json
+import argparse
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Merges per-TU taint summaries')
+    parser.add_argument("summary_files", nargs="+", type=str, help="Summary files, from -tu-summary")
+    parser.add_argument('-o', type=str, dest="out_file", help="Output file")
+    global cmdline_args
+    cmdline_args = parser.parse_args()
+    return cmdline_args
+
+def read_json_file(filename):
+    with open(filename, 'rt') as f:
+        return json.load(f)
+
+# The merged flows form a graph whose nodes are the sinks of each function:
+# (ix_tu, name, ("param", arg)) for its return value and OUT arguments,
+# (ix_tu, name, ("ext_in", callsite, arg)) for the arguments of calls into
+# other TUs (a callsite is (ix_tu, ix)), and (ix_tu, name, ("real", id)) for
+# real sinks.  The taint of a node is a set of ids of real sources and of
+# ("param", arg) for the function's own parameters.
+class Merger:
+    def __init__(self, tus):
+        self.tus = tus
+        self.real_ids = {}     # rendered real scrink -> id
+        self.reals = []        # id -> real scrink
+        self.defs = {}         # name -> (ix_tu, name), for external definitions
+        self.funcs = []        # (ix_tu, name) of every function
+        self.taint = {}        # node -> set of taints
+        self.succs = {}        # node -> nodes whose taint includes all of its taint
+        # (ix_tu, name, ("param", arg)) of a callee -> [(caller, callsite,
+        # node)] for each node of a caller tainted by that OUT argument.
+        self.out_users = {}
+        # (ix_tu, name) of a callee -> [(caller, callsite)] for its callsites.
+        self.callsites_of = {}
+        self.work_list = []
+
+    def real_id(self, scrink):
+        key = scrink["json"]
+        if key not in self.real_ids:
+            self.real_ids[key] = len(self.reals)
+            self.reals.append(scrink)
+        return self.real_ids[key]
+
+    def scrink_key(self, ix_tu, scrink):
+        kind = scrink["kind"]
+        if kind == "real":
+            return ("real", self.real_id(scrink))
+        if kind == "param":
+            return ("param", scrink["arg"])
+        return (kind, (ix_tu, scrink["callsite"]), scrink["arg"])
+
+    def add_taint(self, node, taints):
+        old = self.taint.setdefault(node, set())
+        new = taints - old
+        if new:
+            old |= new
+            self.work_list.append((node, new))
+
+    def add_edge(self, src, dst):
+        succs = self.succs.setdefault(src, [])
+        if dst not in succs:
+            succs.append(dst)
+            self.add_taint(dst, self.taint.get(src, set()))
+
+    def build(self):
+        for (ix_tu, tu) in enumerate(self.tus):
+            for func in tu["functions"]:
+                if not func["external"]:
+                    continue
+                if func["name"] in self.defs:
+                    print("Warning: %s is defined in both %s and %s" % (
+                        func["name"], self.tus[self.defs[func["name"]][0]]["module"], tu["module"]),
+                        file=sys.stderr)
+                else:
+                    self.defs[func["name"]] = (ix_tu, func["name"])
+        for (ix_tu, tu) in enumerate(self.tus):
+            scrinks = tu["scrinks"]
+            for func in tu["functions"]:
+                caller = (ix_tu, func["name"])
+                self.funcs.append(caller)
+                callsites = set()
+                for flow in func["flows"]:
+                    sink_key = self.scrink_key(ix_tu, scrinks[flow[0]])
+                    node = caller + (sink_key,)
+                    self.add_taint(node, set())
+                    if sink_key[0] == "ext_in":
+                        callsites.add((self.defs.get(scrinks[flow[0]]["func"]), sink_key[1]))
+                    for ix_src in flow[1:]:
+                        scrink = scrinks[ix_src]
+                        src_key = self.scrink_key(ix_tu, scrink)
+                        if src_key[0] == "real":
+                            self.add_taint(node, {src_key[1]})
+                        elif src_key[0] == "param":
+                            self.add_taint(node, {src_key})
+                        else:
+                            callee = self.defs.get(scrink["func"])
+                            if callee is not None:
+                                self.out_users.setdefault(callee + (("param", src_key[2]),), []).append(
+                                    (caller, src_key[1], node))
+                for (callee, callsite) in callsites:
+                    if callee is not None:
+                        self.callsites_of.setdefault(callee, []).append((caller, callsite))
+
+    # Replaces a callee's summary of its OUT arguments and of the real
+    # sinks its parameters reach at each callsite, the same way the pass
+    # plugs in the summary of a callee in the same TU.  Taint only grows, so
+    # this terminates.
+    def propagate(self):
+        while self.work_list:
+            (node, new) = self.work_list.pop()
+            for succ in self.succs.get(node, ()):
+                self.add_taint(succ, new)
+            params = [taint for taint in new if isinstance(taint, tuple)]
+            if node[2][0] == "param":
+                reals = new.difference(params)
+                for (caller, callsite, user) in self.out_users.get(node, ()):
+                    self.add_taint(user, reals)
+                    for param in params:
+                        self.add_edge(caller + (("ext_in", callsite, param[1]),), user)
+            elif node[2][0] == "real" and params:
+                for (caller, callsite) in self.callsites_of.get(node[:2], ()):
+                    for param in params:
+                        self.add_edge(caller + (("ext_in", callsite, param[1]),), caller + (node[2],))
+
+    def dump_flows(self, outf):
+        outf.write("\n############################################################\n")
+        outf.write("# FULL FLOWS\n")
+        outf.write("############################################################\n")
+        sinks_of = {}
+        for (node, taints) in self.taint.items():
+            if node[2][0] == "real":
+                sinks_of.setdefault(node[:2], []).append((node[2][1], taints))
+        for func in self.funcs:
+            printed_header = False
+            for (sink_id, taints) in sorted(sinks_of.get(func, [])):
+                sink = self.reals[sink_id]
+                srcs = [self.reals[taint] for taint in taints if not isinstance(taint, tuple)]
+                srcs = [src for src in srcs if not (src["const"] and sink["aux"] != "file")]
+                if not srcs:
+                    continue
+                if not printed_header:
+                    printed_header = True
+                    outf.write("################## \n")
+                    outf.write("# Function: %s\n" % (func[1],))
+                    outf.write("<flows>\n[\n")
+                outf.write('  {"sink": %s,\n   "sources": [\n' % (sink["json"],))
+                for src_json in sorted(src["json"] for src in srcs):
+                    outf.write("    %s,\n" % (src_json,))
+                outf.write("  ]},\n")
+            if not printed_header:
+                outf.write("Function %s: no full flows.\n" % (func[1],))
+            else:
+                outf.write("]\n</flows>\n")
+
+def main():
+    parse_args()
+    tus = [read_json_file(filename) for filename in cmdline_args.summary_files]
+    merger = Merger(tus)
+    merger.build()
+    merger.propagate()
+    if cmdline_args.out_file:
+        with open(cmdline_args.out_file, "w") as outf:
+            merger.dump_flows(outf)
+    else:
+        merger.dump_flows(sys.stdout)
+
+main()
@@ -0,0 +1,165 @@
+# <legal>
+# DMC Tool
+# Copyright 2023 Carnegie Mellon University.
+# 
+# NO WARRANTY. THIS CARNEGIE MELLON UNIVERSITY AND SOFTWARE ENGINEERING INSTITUTE
+# MATERIAL IS FURNISHED ON AN "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO
+# WARRANTIES OF ANY KIND, EITHER EXPRESSED OR IMPLIED, AS TO ANY MATTER
+# INCLUDING, BUT NOT LIMITED TO, WARRANTY OF FITNESS FOR PURPOSE OR
+# MERCHANTABILITY, EXCLUSIVITY, OR RESULTS OBTAINED FROM USE OF THE MATERIAL.
+# CARNEGIE MELLON UNIVERSITY DOES NOT MAKE ANY WARRANTY OF ANY KIND WITH RESPECT
+# TO FREEDOM FROM PATENT, TRADEMARK, OR COPYRIGHT INFRINGEMENT.
+# 
+# Released under a MIT (SEI)-style license, please see License.txt or contact
+# permission@sei.cmu.edu for full terms.
+# 
+# [DISTRIBUTION STATEMENT A] This material has been approved for public release
+# and unlimited distribution.  Please see Copyright notice for non-US Government
+# use and distribution.
+# 
+# Carnegie Mellon (R) and CERT (R) are registered in the U.S. Patent and Trademark
+# Office by Carnegie Mellon University.
+# 
+# This Software includes and/or makes use of the following Third-Party Software
+# subject to its own license:
+# 1. Phasar
+#     (https://github.com/secure-software-engineering/phasar/blob/development/LICENSE.txt)
+#     Copyright 2017 - 2023 Philipp Schubert and others.  
+# 2. LLVM (https://github.com/llvm/llvm-project/blob/main/LICENSE.TXT) 
+#     Copyright 2003 - 2022 LLVM Team.
+# 
+# DM23-0532
+# </legal>
+
+
+# Runs the taint pass on synthetic modules of increasing size, generated by
+# gen_bench.py with the given parameters, and records for each size the
+# wall time, the peak RSS, and the counters of -taint-stats-json (functions
+# analyzed, analyzeFunc calls, time of the analysis phase).  The results are
+# printed as a table and can be saved as JSON, one scaling curve per build
+# of the pass, to compare builds.  Builds older than -taint-stats-json are
+# benchmarked with --no-stats, for the wall time and peak RSS only.
+
+import os
+import sys
+import json
+import time
+import argparse
+import tempfile
+import subprocess
+from pathlib import Path
+
+import gen_bench
+
+REPO_DIR = Path(__file__).resolve().parent.parent
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Benchmarks the taint pass on synthetic modules')
+    parser.add_argument("--lib", type=str, default="/host_dmc/condmerge/libTaint.so", help="The taint pass plugin")
+    parser.add_argument("--llvm-version", type=int, default=int(os.environ.get("CLANGVER", "14")),
+                        help="LLVM version of opt (default $CLANGVER)")
+    parser.add_argument("--opt", type=str, default=None, help="opt to run (default opt-VERSION, or opt for LLVM 17)")
+    parser.add_argument("--sizes", type=str, default="250,500,1000,2000,4000",
+                        help="Comma-separated numbers of functions (default 250,500,1000,2000,4000)")
+    parser.add_argument("--repeat", type=int, default=1, help="Runs per size; the fastest is kept (default 1)")
+    parser.add_argument("--pass-args", type=str, default="", help="More arguments for the pass, e.g. '-taint-threads=4'")
+    parser.add_argument("--work-dir", type=str, default=None, help="Where to keep the modules (default a temporary directory)")
+    parser.add_argument("--no-stats", action="store_true",
+                        help="Don't pass -taint-stats-json, for builds without it; only time and RSS are recorded")
+    parser.add_argument('-o', type=str, dest="out_file", help="JSON file for the results")
+    gen_bench.add_params(parser)
+    global cmdline_args
+    cmdline_args = parser.parse_args()
+    cmdline_args.opaque_pointers = cmdline_args.opaque_pointers or cmdline_args.llvm_version >= 17
+    return cmdline_args
+
+# As run_taint_pass.sh
+def pass_command(ll_file, wrappers_file, stats_file):
+    args = cmdline_args
+    if args.llvm_version < 17:
+        opt = args.opt or "opt-%d" % (args.llvm_version,)
+        cmd = [opt, "-enable-new-pm=0", "-load", args.lib, "-mem2reg", "-taint"]
+    else:
+        opt = args.opt or "opt"
+        cmd = [opt, "-load-pass-plugin=" + args.lib, "-passes=function(mem2reg),taint"]
+    cmd += ["-o", "/dev/null", ll_file,
+            "--sources-and-sinks", str(REPO_DIR / "gpt" / "func_taint3.txt"),
+            "--taint-copiers", str(REPO_DIR / "taint_copiers.txt"),
+            "--wrappers", wrappers_file]
+    if not args.no_stats:
+        cmd.append("-taint-stats-json=" + stats_file)
+    return cmd + args.pass_args.split()
+
+# Runs the pass once; returns (wall seconds, peak RSS in KB, stats) or None
+def run_pass(cmd, stats_file):
+    start = time.perf_counter()
+    proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    stderr = proc.stderr.read()
+    _, status, rusage = os.wait4(proc.pid, 0)
+    wall = time.perf_counter() - start
+    if os.waitstatus_to_exitcode(status) != 0:
+        sys.stderr.write(stderr.decode(errors="replace"))
+        return None
+    if cmdline_args.no_stats:
+        return wall, rusage.ru_maxrss, None
+    with open(stats_file, "rt") as f:
+        stats = json.load(f)
+    # ru_maxrss is in KB on Linux
+    return wall, rusage.ru_maxrss, stats
+
+def bench_size(work_dir, num_funcs):
+    args = cmdline_args
+    args.funcs = num_funcs
+    ll_file = os.path.join(work_dir, "bench%d.ll" % (num_funcs,))
+    wrappers_file = os.path.join(work_dir, "bench%d.wrappers.txt" % (num_funcs,))
+    stats_file = os.path.join(work_dir, "bench%d.stats.json" % (num_funcs,))
+    gen_bench.generate(args, ll_file, wrappers_file)
+    cmd = pass_command(ll_file, wrappers_file, stats_file)
+    best = None
+    for _ in range(args.repeat):
+        run = run_pass(cmd, stats_file)
+        if run is None:
+            print("Error: the pass failed on %s: %s" % (ll_file, " ".join(cmd)), file=sys.stderr)
+            sys.exit(1)
+        if best is None or run[0] < best[0]:
+            best = run
+    wall, rss_kb, stats = best
+    if stats is None:
+        return {"funcs": num_funcs, "wall": wall, "peak_rss_kb": rss_kb}
+    counters = stats["counters"]
+    return {
+        "funcs": num_funcs,
+        "wall": wall,
+        "analysis_wall": stats["timers"]["analysis"]["wall"],
+        "peak_rss_kb": rss_kb,
+        "functions_analyzed": counters["functions_analyzed"],
+        "analyses": counters["analyses"],
+        "inst_visits": counters["inst_visits"],
+        "peak_summary_size": counters["peak_summary_size"],
+    }
+
+def main():
+    args = parse_args()
+    sizes = [int(size) for size in args.sizes.split(",")]
+    params = {name: getattr(args, name) for name in
+              ["depth", "width", "scc_size", "recursion", "sources", "sinks", "wrapper_density", "globals", "sharing", "seed"]}
+    print("%8s %10s %10s %10s %10s %12s" % ("funcs", "wall (s)", "analysis", "RSS (MB)", "analyses", "inst visits"))
+    results = []
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        work_dir = args.work_dir or tmp_dir
+        os.makedirs(work_dir, exist_ok=True)
+        for num_funcs in sizes:
+            r = bench_size(work_dir, num_funcs)
+            results.append(r)
+            if "analyses" in r:
+                print("%8d %10.3f %10.3f %10.1f %10d %12d" % (r["funcs"], r["wall"], r["analysis_wall"],
+                                                             r["peak_rss_kb"] / 1024, r["analyses"], r["inst_visits"]))
+            else:
+                print("%8d %10.3f %10s %10.1f %10s %12s" % (r["funcs"], r["wall"], "-", r["peak_rss_kb"] / 1024, "-", "-"))
+            sys.stdout.flush()
+    if args.out_file:
+        with open(args.out_file, "wt") as outf:
+            json.dump({"lib": args.lib, "params": params, "results": results}, outf, indent=1)
+            outf.write("\n")
+
+main()
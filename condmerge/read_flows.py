@@ -0,0 +1,211 @@
+# <legal>
+# DMC Tool
+# Copyright 2023 Carnegie Mellon University.
+# 
+# NO WARRANTY. THIS CARNEGIE MELLON UNIVERSITY AND SOFTWARE ENGINEERING INSTITUTE
+# MATERIAL IS FURNISHED ON AN "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO
+# WARRANTIES OF ANY KIND, EITHER EXPRESSED OR IMPLIED, AS TO ANY MATTER
+# INCLUDING, BUT NOT LIMITED TO, WARRANTY OF FITNESS FOR PURPOSE OR
+# MERCHANTABILITY, EXCLUSIVITY, OR RESULTS OBTAINED FROM USE OF THE MATERIAL.
+# CARNEGIE MELLON UNIVERSITY DOES NOT MAKE ANY WARRANTY OF ANY KIND WITH RESPECT
+# TO FREEDOM FROM PATENT, TRADEMARK, OR COPYRIGHT INFRINGEMENT.
+# 
+# Released under a MIT (SEI)-style license, please see License.txt or contact
+# permission@sei.cmu.edu for full terms.
+# 
+# [DISTRIBUTION STATEMENT A] This material has been approved for public release
+# and unlimited distribution.  Please see Copyright notice for non-US Government
+# use and distribution.
+# 
+# Carnegie Mellon (R) and CERT (R) are registered in the U.S. Patent and Trademark
+# Office by Carnegie Mellon University.
+# 
+# This Software includes and/or makes use of the following Third-Party Software
+# subject to its own license:
+# 1. Phasar
+#     (https://github.com/secure-software-engineering/phasar/blob/development/LICENSE.txt)
+#     Copyright 2017 - 2023 Philipp Schubert and others.  
+# 2. LLVM (https://github.com/llvm/llvm-project/blob/main/LICENSE.TXT) 
+#     Copyright 2003 - 2022 LLVM Team.
+# 
+# DM23-0532
+# </legal>
+
+# Converts the binary output of the taint pass (-output-format=binary) back
+# to the text output, i.e., the function summaries, the "FULL FLOWS" for
+# connect_flows.py, and the unrecognized external functions.  The binary
+# file is mmap'ed, and each scrink is rendered once, however many flows
+# refer to it.  See writeBinary in taint.cpp for the layout.
+
+import sys
+import mmap
+import struct
+import argparse
+
+MAGIC = b"DMCB"
+VERSION = 1
+NONE = 0xffffffff
+NUM_SECTIONS = 8
+
+RECORD_RETURN = 0
+RECORD_ARG = 1
+RECORD_PARAM_SINK = 2
+RECORD_FLOW = 3
+
+AUX_NAMES = {0: b"null", 1: b"main", 2: b"file", 3: b"ext_in", 4: b"ext_out"}
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Converts binary taint pass output to text')
+    parser.add_argument("input_file", type=str, help="Binary output, from -output-format=binary")
+    parser.add_argument('-o', type=str, dest="out_file", help="Output file")
+    global cmdline_args
+    cmdline_args = parser.parse_args()
+    return cmdline_args
+
+def signed(x):
+    return x - (1 << 32) if x >= (1 << 31) else x
+
+class BinaryFlows:
+    def __init__(self, buf):
+        if buf[:4] != MAGIC:
+            raise ValueError("Not a binary taint pass output file")
+        (version,) = struct.unpack_from("<I", buf, 4)
+        if version != VERSION:
+            raise ValueError("Unsupported binary format version %d" % (version,))
+        sections = struct.unpack_from("<%dI" % (2 * NUM_SECTIONS,), buf, 8)
+        sections = [(sections[2*i], sections[2*i + 1]) for i in range(NUM_SECTIONS)]
+        (str_offsets, data, callsites, scrinks, functions, records, refs, unrecognized) = sections
+        offsets = self.table(buf, str_offsets[0], str_offsets[1] + 1, 1)
+        data_start = data[0]
+        self.strings = [bytes(buf[data_start + offsets[i]:data_start + offsets[i + 1]])
+                        for i in range(str_offsets[1])]
+        self.callsites = self.table(buf, *callsites, 5)
+        self.scrinks = self.table(buf, *scrinks, 8)
+        self.functions = self.table(buf, *functions, 5)
+        self.records = self.table(buf, *records, 4)
+        self.refs = self.table(buf, *refs, 1)
+        self.unrecognized = self.table(buf, *unrecognized, 1)
+        self.rendered = {}
+
+    @staticmethod
+    def table(buf, offset, count, width):
+        return struct.unpack_from("<%dI" % (count * width,), buf, offset)
+
+    def list(self, first, count):
+        return self.refs[first:first + count]
+
+    # As write_file_line_col in taint.cpp.
+    def callsite(self, ix):
+        (file, func, line, col, _) = self.callsites[5*ix:5*ix + 5]
+        if file == NONE:
+            return b'["???", -1, -1]'
+        return b'["%s","%s",%d,%d]' % (self.strings[file], self.strings[func], line, col)
+
+    # As dumpSrcOrSink in taint.cpp; the wrapped scrink is rendered only
+    # with an indent.
+    def scrink(self, ix, indent=None):
+        key = (ix, indent)
+        if key in self.rendered:
+            return self.rendered[key]
+        (func, arg, aux, callsite, wrapped, aux_file, std_first, std_count) = self.scrinks[8*ix:8*ix + 8]
+        if aux_file != NONE:
+            s = b'{"aux_file":"%s"}' % (self.strings[aux_file],)
+        else:
+            s = [b'{"Func":"%s"' % (self.strings[func] if func != NONE else b"null",)]
+            s.append(b', "aux":"%s"' % (AUX_NAMES.get(aux, b"(error)"),))
+            is_wrapped = (wrapped != NONE and indent is not None)
+            if not is_wrapped:
+                s.append(b', "arg":%d' % (signed(arg),))
+            s.append(b', "callsite": ')
+            if callsite != NONE:
+                s.append(self.callsite(callsite))
+                for sf in self.list(std_first, std_count):
+                    s.append(b', "FILE*":"%s"' % (self.strings[sf],))
+            else:
+                s.append(b"null")
+            if is_wrapped:
+                s.append(b', "wrapped": \n' + indent + self.scrink(wrapped))
+            s.append(b"}")
+            s = b"".join(s)
+        self.rendered[key] = s
+        return s
+
+    def func_records(self, ix_func):
+        (name, args_first, args_count, rec_first, rec_count) = self.functions[5*ix_func:5*ix_func + 5]
+        recs = [self.records[4*i:4*i + 4] for i in range(rec_first, rec_first + rec_count)]
+        return self.strings[name], self.list(args_first, args_count), recs
+
+    # As printFuncSummary in taint.cpp.
+    def dump_summary(self, out, ix_func):
+        name, arg_names, recs = self.func_records(ix_func)
+        out.append(b"################## \n")
+        out.append(b"# Function: %s\n" % (name,))
+        for (kind, sink, src_first, src_count) in recs:
+            srcs = self.list(src_first, src_count)
+            if kind == RECORD_RETURN:
+                out.append(b'"Return": [')
+                out.extend(self.scrink(src) + b", " for src in srcs)
+                out.append(b"]\n")
+            elif kind == RECORD_ARG:
+                out.append(b"Arg %d: %s: " % (sink, self.strings[arg_names[sink]]))
+                out.extend(self.scrink(src) + b", " for src in srcs)
+                out.append(b"\n")
+        out.append(b'"Sinks": [\n')
+        for (kind, sink, src_first, src_count) in recs:
+            if kind != RECORD_PARAM_SINK:
+                continue
+            (_, _, _, callsite, _, _, _, _) = self.scrinks[8*sink:8*sink + 8]
+            (_, _, _, _, callee) = self.callsites[5*callsite:5*callsite + 5]
+            (_, arg, _, _, _, _, _, _) = self.scrinks[8*sink:8*sink + 8]
+            out.append(b'  [%s, "%s arg %d", [\n' % (self.callsite(callsite), self.strings[callee], signed(arg)))
+            out.extend(b"    %s,\n" % (self.scrink(src),) for src in self.list(src_first, src_count))
+            out.append(b"  ]],\n")
+        out.append(b"]\n")
+
+    # As printFuncTaints in taint.cpp.
+    def dump_flows(self, out, ix_func):
+        name, _, recs = self.func_records(ix_func)
+        printed_header = False
+        for (kind, sink, src_first, src_count) in recs:
+            if kind != RECORD_FLOW:
+                continue
+            if not printed_header:
+                printed_header = True
+                out.append(b"################## \n")
+                out.append(b"# Function: %s\n" % (name,))
+                out.append(b"<flows>\n[\n")
+            out.append(b'  {"sink": %s,\n   "sources": [\n' % (self.scrink(sink, b"      "),))
+            out.extend(b"    %s,\n" % (self.scrink(src, b"      "),) for src in self.list(src_first, src_count))
+            out.append(b"  ]},\n")
+        if not printed_header:
+            out.append(b"Function %s: no full flows.\n" % (name,))
+        else:
+            out.append(b"]\n</flows>\n")
+
+    def dump(self, outf):
+        num_funcs = len(self.functions) // 5
+        banner = b"\n############################################################\n"
+        out = [banner, b"# Function summaries\n", banner[1:]]
+        for ix_func in range(num_funcs):
+            self.dump_summary(out, ix_func)
+        out.extend([banner, b"# FULL FLOWS\n", banner[1:]])
+        for ix_func in range(num_funcs):
+            self.dump_flows(out, ix_func)
+        out.append(banner)
+        out.append(b"Unrecognized external functions: [ ")
+        out.extend(self.strings[func] + b" " for func in self.unrecognized)
+        out.append(b"]\n")
+        outf.write(b"".join(out))
+
+def main():
+    parse_args()
+    with open(cmdline_args.input_file, "rb") as f:
+        with mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as buf:
+            flows = BinaryFlows(buf)
+    if cmdline_args.out_file:
+        with open(cmdline_args.out_file, "wb") as outf:
+            flows.dump(outf)
+    else:
+        flows.dump(sys.stdout.buffer)
+
+main()
@@ -35,6 +35,7 @@
 #include <set>
 #include <unordered_set>
 #include <queue>
+#include <deque>
 #include <utility>
 #include <optional>
 
@@ -43,6 +44,13 @@
 #include <sstream>
 #include <vector>
 #include <string>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <memory>
+#include <chrono>
 
 #include <llvm/Pass.h>
 #include <llvm/IR/Module.h>
@@ -68,7 +76,22 @@
 #include <llvm/IR/Type.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/ADT/Hashing.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/SparseBitVector.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/EndianStream.h>
+#include <llvm/Support/ErrorHandling.h>
 #include <llvm/Support/Debug.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Timer.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/Process.h>
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/DebugLoc.h"
@@ -113,16 +136,18 @@ void write_line_col(DebugLoc dl) {
   }
 }
 
-void write_file_line_col(Instruction* inst) {
+void write_file_line_col(Instruction* inst, llvm::raw_ostream &os = outs(), StringRef baseDir = "") {
   llvm::DebugLoc dl = inst->getDebugLoc();
   if (dl) {
+    StringRef filename = dl.get()->getFilename();
+    filename.consume_front(baseDir);
     // TODO: Escape any quotation marks in the filename.
-    outs() << "[\"" << dl.get()->getFilename() << "\",";
-    outs() << "\"" << inst->getFunction()->getName() << "\",";
-    outs() << "" << dl.getLine() << "," << dl.getCol() << "]";
-    outs() << "";
+    os << "[\"" << filename << "\",";
+    os << "\"" << inst->getFunction()->getName() << "\",";
+    os << "" << dl.getLine() << "," << dl.getCol() << "]";
+    os << "";
   } else {
-    outs() << "[\"???\", -1, -1]";
+    os << "[\"???\", -1, -1]";
   }
 }
 
@@ -148,14 +173,21 @@ bool looks_like_filename(string str) {
 #define AUX_TYPE_NULL 0
 #define AUX_TYPE_MAIN 1
 #define AUX_TYPE_FILE 2
+#define AUX_TYPE_EXT_IN 3  // placeholder sink: what flows into a call to another TU
+#define AUX_TYPE_EXT_OUT 4 // placeholder source: what flows out of such a call
+
+#define AUTO_WRAPPER_MAX_INSTS 100 // largest function that -auto-wrappers treats as a wrapper
 
 map<llvm::GlobalVariable*, set<llvm::Function*>> fnsReferencingGvar;
+map<llvm::GlobalVariable*, set<llvm::Function*>> fnsWritingGvar; // a subset of fnsReferencingGvar
 
 const char* getAuxName(int aux) {
   switch (aux) {
     case AUX_TYPE_NULL: return "null";
     case AUX_TYPE_MAIN: return "main";
     case AUX_TYPE_FILE: return "file";
+    case AUX_TYPE_EXT_IN: return "ext_in";
+    case AUX_TYPE_EXT_OUT: return "ext_out";
     default: return "(error)";
   }
 }
@@ -182,7 +214,7 @@ struct SrcOrSink_t {
   int ixArg;  // 0-indexed, and RETVAL_CODE (-1) denotes the return value.
   llvm::CallBase* callsite; // see below note about what callsite==nullptr means.
   int auxType;
-  struct SrcOrSink_t* wrapped;
+  const struct SrcOrSink_t* wrapped;
   llvm::Value* auxConst;
   // A NULL value for callsite means that this is representing a function
   // argument or return value as source/sink in a function summary, not a true
@@ -192,8 +224,38 @@ struct SrcOrSink_t {
   bool isSummaryScrink() const {
     return (callsite == nullptr) && (auxConst == nullptr);
   }
+  // Placeholders stand for calls into other translation units, and are
+  // replaced by the callees' summaries when the TUs are merged.
+  bool isPlaceholder() const {
+    return auxType == AUX_TYPE_EXT_IN || auxType == AUX_TYPE_EXT_OUT;
+  }
   bool operator==(const SrcOrSink_t& other) const = default;
-  auto operator<=>(const SrcOrSink_t& other) const = default;
+  // 'wrapped' points to a scrink interned by storeScrink, whose address
+  // depends on the order in which the analysis happened to reach it, so
+  // compare it by value to keep set (and output) order deterministic.
+  std::strong_ordering operator<=>(const SrcOrSink_t& other) const {
+    if (func != other.func) {
+      return func <=> other.func;
+    }
+    if (ixArg != other.ixArg) {
+      return ixArg <=> other.ixArg;
+    }
+    if (callsite != other.callsite) {
+      return callsite <=> other.callsite;
+    }
+    if (auxType != other.auxType) {
+      return auxType <=> other.auxType;
+    }
+    if (wrapped != other.wrapped) {
+      if (wrapped == nullptr || other.wrapped == nullptr) {
+        return (wrapped == nullptr) ? std::strong_ordering::less : std::strong_ordering::greater;
+      }
+      if (auto cmp = *wrapped <=> *other.wrapped; cmp != 0) {
+        return cmp;
+      }
+    }
+    return auxConst <=> other.auxConst;
+  }
 
 };
 
@@ -224,16 +286,146 @@ using SensSrc_t = SrcOrSink_t;
  ****************************************************************************/
 
 
-const set<SensSrc_t>& asSingleSet(const set<SensSrc_t>& x) {
-  return x;
+/*****************************************************************************
+ * Interning table for sources/sinks.  Every SrcOrSink_t that appears in a
+ * taint set gets a dense integer ID, so that taint sets can be bit vectors.
+ * Scrinks are stored in fixed-size chunks that never move: pointers into the
+ * table stay valid (storeScrink hands them out for 'wrapped'), and an ID
+ * received from another thread can be looked up without taking the lock.
+ ****************************************************************************/
+
+using ScrinkId = unsigned;
+
+// Hashing for the interning table.  'wrapped' always points into the table
+// itself, so comparing and hashing it by address is the same as by value.
+template<> struct llvm::DenseMapInfo<SrcOrSink_t> {
+  static inline SrcOrSink_t getEmptyKey() {
+    return {DenseMapInfo<llvm::Function*>::getEmptyKey()};
+  }
+  static inline SrcOrSink_t getTombstoneKey() {
+    return {DenseMapInfo<llvm::Function*>::getTombstoneKey()};
+  }
+  static unsigned getHashValue(const SrcOrSink_t& scrink) {
+    return hash_combine(scrink.func, scrink.ixArg, scrink.callsite, scrink.auxType,
+                        scrink.wrapped, scrink.auxConst);
+  }
+  static bool isEqual(const SrcOrSink_t& lhs, const SrcOrSink_t& rhs) {
+    return lhs == rhs;
+  }
+};
+
+class ScrinkTable {
+  public:
+  static const unsigned CHUNK_BITS = 12;
+  static const unsigned MAX_CHUNKS = 1 << 16;
+
+  ScrinkTable() {
+    chunks.reserve(MAX_CHUNKS); // so that push_back never moves the chunk pointers
+  }
+
+  // Almost every scrink is already interned, so the lookup only takes the
+  // lock shared, and concurrent analyses don't serialize on it.
+  ScrinkId intern(const SrcOrSink_t& scrink) {
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex);
+      auto itId = idOf.find(scrink);
+      if (itId != idOf.end()) {
+        return itId->second;
+      }
+    }
+    std::lock_guard<std::shared_mutex> lock(mutex);
+    auto [itId, isNew] = idOf.insert({scrink, numScrinks});
+    if (isNew) {
+      if ((numScrinks >> CHUNK_BITS) == chunks.size()) {
+        if (chunks.size() == MAX_CHUNKS) {
+          report_fatal_error("taint: too many distinct sources and sinks");
+        }
+        chunks.emplace_back(new SrcOrSink_t[1 << CHUNK_BITS]);
+      }
+      chunks[numScrinks >> CHUNK_BITS][numScrinks & ((1 << CHUNK_BITS) - 1)] = scrink;
+      numScrinks++;
+    }
+    return itId->second;
+  }
+
+  const SrcOrSink_t& operator[](ScrinkId id) const {
+    return chunks[id >> CHUNK_BITS][id & ((1 << CHUNK_BITS) - 1)];
+  }
+
+  private:
+  std::shared_mutex mutex;
+  DenseMap<SrcOrSink_t, ScrinkId> idOf;
+  vector<unique_ptr<SrcOrSink_t[]>> chunks;
+  ScrinkId numScrinks = 0;
+};
+
+ScrinkTable scrinkTable;
+
+// A set of sources, stored as a bit vector of interned IDs so that unions are
+// word-wise ORs.  Iteration yields the scrinks in ID order, i.e., the order in
+// which they were first seen; use asSingleSet() where the order is visible.
+class SrcBitSet {
+  public:
+  class iterator {
+    public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = SrcOrSink_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const SrcOrSink_t*;
+    using reference = const SrcOrSink_t&;
+    SparseBitVector<>::iterator itId;
+    const SrcOrSink_t& operator*() const { return scrinkTable[*itId]; }
+    const SrcOrSink_t* operator->() const { return &scrinkTable[*itId]; }
+    iterator& operator++() { ++itId; return *this; }
+    bool operator==(const iterator& other) const { return itId == other.itId; }
+  };
+
+  SparseBitVector<> ids;
+
+  bool insert(const SrcOrSink_t& src) {
+    return ids.test_and_set(scrinkTable.intern(src));
+  }
+
+  bool insert(const SrcBitSet& other) {
+    return ids |= other.ids;
+  }
+
+  size_t size() const {
+    return ids.count();
+  }
+
+  bool empty() const {
+    return ids.empty();
+  }
+
+  bool contains(const SrcBitSet& other) const {
+    return ids.contains(other.ids);
+  }
+
+  bool operator==(const SrcBitSet& other) const {
+    return ids == other.ids;
+  }
+
+  iterator begin() const {
+    return {ids.begin()};
+  }
+
+  iterator end() const {
+    return {ids.end()};
+  }
+};
+
+// Sorted copy of a taint set, for deterministic output.
+set<SensSrc_t> asSingleSet(const SrcBitSet& x) {
+  return set<SensSrc_t>(x.begin(), x.end());
 }
 
 // const set<SensSrc_t> asSingleSetCopy(const set<SensSrc_t>& x) {
 //   return x;
 // }
 
-using SensSrcSet_t = set<SensSrc_t>;
-//using SensSrcSet_t = SrcAliasedSet;
+//using SensSrcSet_t = set<SensSrc_t>;
+using SensSrcSet_t = SrcBitSet;
 
 
 // #define UNCHANGED 'U'
@@ -244,6 +436,57 @@ void extendWith(std::set<T>& destination, const std::set<T>& source) {
   destination.insert(source.begin(), source.end());
 }
 
+bool extendWith(SensSrcSet_t& destination, const SensSrcSet_t& source) {
+  return destination.insert(source);
+}
+
+// A function summary: the sources flowing into each sink.  Unordered, so
+// printing code sorts the sinks first.  Taint only grows, so 'version' is
+// bumped whenever a sink is added or its sources grow, and a summary has
+// changed iff its version has.
+class FuncSummary_t {
+  public:
+  using FlowMap_t = DenseMap<Sink_t, SensSrcSet_t>;
+  unsigned version = 0;
+
+  // The sources of sink, added if missing.  Whoever grows the returned set
+  // must report it with noteGrowth.
+  SensSrcSet_t& sourcesOf(const Sink_t& sink) {
+    auto [itSink, isNew] = flowsBySink.try_emplace(sink);
+    noteGrowth(isNew);
+    return itSink->second;
+  }
+
+  void noteGrowth(bool grew) {
+    if (grew) {
+      version++;
+    }
+  }
+
+  // The sources of sink, or null if none were added.
+  const SensSrcSet_t* find(const Sink_t& sink) const {
+    auto itSink = flowsBySink.find(sink);
+    return (itSink == flowsBySink.end()) ? nullptr : &itSink->second;
+  }
+
+  // Drops all the flows, to compute the summary again from scratch.
+  void clear() {
+    flowsBySink.clear();
+    version++;
+  }
+
+  FlowMap_t::const_iterator begin() const {
+    return flowsBySink.begin();
+  }
+
+  FlowMap_t::const_iterator end() const {
+    return flowsBySink.end();
+  }
+
+  private:
+  FlowMap_t flowsBySink;
+};
+
 void copySet(SensSrcSet_t& base, SensSrcSet_t& addl) {
   // int n = base.size();
   extendWith(base, addl);
@@ -269,11 +512,36 @@ Value* passThruGep(Value* val) {
 }
 
 
+
+
 class AliasedTaintMap {
   public:
-  static map<Value*, SensSrcSet_t> globalSrcTaintSet;
-  map<Value*, SensSrcSet_t> baseTaintOf;
-  map<Value*, set<Value*>> aliasesOf;
+  static DenseMap<Value*, SensSrcSet_t> globalSrcTaintSet;
+  static std::shared_mutex globalSrcTaintMutex; // globals are shared by concurrently analyzed functions
+  DenseMap<Value*, SensSrcSet_t> baseTaintOf;
+  DenseMap<Value*, set<Value*>> aliasesOf;
+  set<llvm::GlobalVariable*> grownGlobals; // globals whose taint grew via this map
+  bool wroteGlobals = false; // whether any taint was added to globals, grown or not
+
+  // Bookkeeping for sparse propagation in analyzeFunc: which instructions
+  // have read each location, and which locations grew (in taint, or in
+  // aliases) since analyzeFunc last looked.
+  Instruction* currentReader = nullptr;
+  DenseMap<Value*, set<Instruction*>> readersOf;
+  vector<Value*> grownLocs;
+  uint64_t numUnions = 0; // for -taint-stats
+
+  void noteRead(Value* loc) {
+    if (currentReader) {
+      readersOf[loc].insert(currentReader);
+    }
+  }
+
+  void noteGrowth(Value* loc, bool grew) {
+    if (grew) {
+      grownLocs.push_back(loc);
+    }
+  }
 
   bool addTaint(Value* loc, SensSrc_t src) {
     /*
@@ -281,7 +549,7 @@ class AliasedTaintMap {
      * If marking a global variable as tainted by another src, return true so we can update the function analysis worklist
      */
     llvm::GlobalVariable* gvar;
-    map<Value*, SensSrcSet_t>* taintMap = &baseTaintOf;
+    DenseMap<Value*, SensSrcSet_t>* taintMap = &baseTaintOf;
     loc = passThruGep(loc);
     if ((gvar = llvm::dyn_cast<llvm::GlobalVariable>(loc)) && src.ixArg != RETVAL_CODE) {
       // llvm::outs() << "Global here! " << *gvar << "\n";
@@ -291,74 +559,150 @@ class AliasedTaintMap {
         return false;
       }
     }
+    std::unique_lock<std::shared_mutex> lock(globalSrcTaintMutex, std::defer_lock);
+    if (taintMap == &globalSrcTaintSet) {
+      lock.lock();
+      wroteGlobals = true;
+    }
     auto itAli = aliasesOf.find(loc);
     if (itAli == aliasesOf.end()) {
-      (*taintMap)[loc].insert(src);
+      bool grew = (*taintMap)[loc].insert(src);
+      noteGrowth(loc, grew);
+      if (grew && taintMap == &globalSrcTaintSet) {
+        grownGlobals.insert(gvar);
+      }
     } else {
       set<Value*>& aliases = itAli->second;
       for (Value* baseLoc: aliases) {
-        (*taintMap)[baseLoc].insert(src);
+        noteGrowth(baseLoc, (*taintMap)[baseLoc].insert(src));
       }
     }
     return gvar;
   }
 
-  bool addTaintSet(Value* loc, SensSrcSet_t srcSet) {
+  bool addTaintSet(Value* loc, const SensSrcSet_t& srcSet) {
     bool addedToGlobalSet = false;
     loc = passThruGep(loc);
-    for (auto src : srcSet) {
+    // addTaint strips a second GEP, and so does the fast path.
+    Value* base = passThruGep(loc);
+    if (!llvm::isa<llvm::GlobalVariable>(base)) {
+      // Only globals filter individual sources, so the rest is a plain union.
+      auto itAli = aliasesOf.find(base);
+      if (itAli == aliasesOf.end()) {
+        noteGrowth(base, baseTaintOf[base].insert(srcSet));
+        numUnions++;
+      } else {
+        for (Value* baseLoc: itAli->second) {
+          noteGrowth(baseLoc, baseTaintOf[baseLoc].insert(srcSet));
+        }
+        numUnions += itAli->second.size();
+      }
+      return false;
+    }
+    for (auto const& src : srcSet) {
       if (addTaint(loc, src))
         addedToGlobalSet = true;
     }
     return addedToGlobalSet;
   }
 
-  SensSrcSet_t getTaintAsSingleSet(Value* loc) {
-    /*
-     * Return the source/set of sources that have tainted this variable
-     */
+  // Calls visit(const SensSrcSet_t&) on each of the base sets whose union
+  // is the taint of loc, without building that union.  The visitor must not
+  // add taint to globals (their lock is held while visiting a global).
+  template<typename Visitor>
+  void forEachTaintSet(Value* loc, Visitor visit) {
     llvm::GlobalVariable* gvar;
-    map<Value*, SensSrcSet_t>* taintMap = &baseTaintOf;
+    DenseMap<Value*, SensSrcSet_t>* taintMap = &baseTaintOf;
     loc = passThruGep(loc);
     if ((gvar = llvm::dyn_cast<llvm::GlobalVariable>(loc))) {
       // llvm::outs() << "Global here! " << *gvar << "\n";
       taintMap = &globalSrcTaintSet;
     }
+    std::shared_lock<std::shared_mutex> lock(globalSrcTaintMutex, std::defer_lock);
+    if (taintMap == &globalSrcTaintSet) {
+      lock.lock();
+    }
+    noteRead(loc);
     auto itAli = aliasesOf.find(loc);
     if (itAli == aliasesOf.end()) {
-      return (*taintMap)[loc];
+      auto itTaint = taintMap->find(loc);
+      if (itTaint != taintMap->end()) {
+        visit(itTaint->second);
+      }
     } else {
-      SensSrcSet_t ret;
-      set<Value*>& aliases = itAli->second;
-      for (Value* baseLoc: aliases) {
-        extendWith(ret, (*taintMap)[baseLoc]);
+      for (Value* baseLoc: itAli->second) {
+        noteRead(baseLoc);
+        auto itTaint = taintMap->find(baseLoc);
+        if (itTaint != taintMap->end()) {
+          visit(itTaint->second);
+        }
       }
-      return ret;
     }
   }
 
+  // Unions the taint of loc into dest.
+  bool unionTaintInto(SensSrcSet_t& dest, Value* loc) {
+    bool grew = false;
+    forEachTaintSet(loc, [&](const SensSrcSet_t& srcSet) {
+      grew |= extendWith(dest, srcSet);
+      numUnions++;
+    });
+    return grew;
+  }
+
+  // Adds the taint of src to dst in place, as addTaintSet(dst, taint of
+  // src) would (stripping two GEPs from dst).
+  bool addTaintFrom(Value* dst, Value* src) {
+    if (llvm::isa<llvm::GlobalVariable>(passThruGep(passThruGep(dst)))) {
+      // Adding to a global takes the globals' lock, so snapshot src first.
+      return addTaintSet(dst, getTaintAsSingleSet(src));
+    }
+    dst = passThruGep(passThruGep(dst));
+    SmallVector<Value*, 4> dstLocs;
+    auto itAli = aliasesOf.find(dst);
+    if (itAli == aliasesOf.end()) {
+      dstLocs.push_back(dst);
+    } else {
+      dstLocs.append(itAli->second.begin(), itAli->second.end());
+    }
+    // Inserting into baseTaintOf may move its entries, so create all the
+    // destination sets before taking pointers to them or visiting src.
+    for (Value* loc : dstLocs) {
+      baseTaintOf[loc];
+    }
+    SmallVector<SensSrcSet_t*, 4> dstSets;
+    for (Value* loc : dstLocs) {
+      dstSets.push_back(&baseTaintOf.find(loc)->second);
+    }
+    forEachTaintSet(src, [&](const SensSrcSet_t& srcSet) {
+      for (size_t ix = 0; ix < dstLocs.size(); ix++) {
+        noteGrowth(dstLocs[ix], dstSets[ix]->insert(srcSet));
+      }
+      numUnions += dstLocs.size();
+    });
+    return false;
+  }
+
+  SensSrcSet_t getTaintAsSingleSet(Value* loc) {
+    /*
+     * Return the source/set of sources that have tainted this variable
+     */
+    SensSrcSet_t ret;
+    unionTaintInto(ret, loc);
+    return ret;
+  }
+
   void addAlias(Value* alias, Value* baseLoc) {
     // TODO: Handle the case where baseLoc is a phi node
     alias = passThruGep(alias);
     baseLoc = passThruGep(baseLoc);
-    aliasesOf[alias].insert(baseLoc);
+    noteGrowth(alias, aliasesOf[alias].insert(baseLoc).second);
     // outs() << "ALIAS   ";
     // alias->dump();
     // outs() << "BASELOC ";
     // baseLoc->dump();
   }
 
-  size_t calcSize() const {
-    size_t ret = 0;
-    for (auto const& [sink, srcSet] : baseTaintOf) {
-      ret += srcSet.size();
-    }
-    for (auto const& [alias, baseLocs] : aliasesOf) {
-      ret += baseLocs.size();
-    }
-    return ret;
-  }
-
   void dump() {
     llvm::raw_ostream& os = errs();
     os << "=================\n";
@@ -372,7 +716,8 @@ class AliasedTaintMap {
   }
 
 };
-map<Value*, SensSrcSet_t> AliasedTaintMap::globalSrcTaintSet; // needed here to provide definition for static class member
+DenseMap<Value*, SensSrcSet_t> AliasedTaintMap::globalSrcTaintSet; // needed here to provide definition for static class member
+std::shared_mutex AliasedTaintMap::globalSrcTaintMutex;
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -381,20 +726,23 @@ using TaintMapType = AliasedTaintMap;
 
 //////////////////////////////////////////////////////////////////////////////
 
+// A FIFO worklist without duplicates.  The queue is a vector whose popped
+// front is dropped once it is most of the vector, so that a long analysis
+// keeps reusing the same memory.
 template<typename T>
 class WorkList {
   public:
-  queue<T> workList;
-  set<T> workSet;
+  vector<T> workList;
+  size_t ixFront = 0;
+  DenseSet<T> workSet;
 
   bool empty() {
-    return workList.empty();
+    return ixFront == workList.size();
   }
 
   void add(T item) {
-    if (workSet.count(item) == 0) {
-      workSet.insert(item);
-      workList.push(item);
+    if (workSet.insert(item).second) {
+      workList.push_back(item);
     }
   }
 
@@ -405,510 +753,3288 @@ class WorkList {
   }
 
   T pop() {
-    T ret = workList.front();
-    workList.pop();
+    T ret = workList[ixFront++];
     workSet.erase(ret);
+    if (ixFront == workList.size()) {
+      workList.clear();
+      ixFront = 0;
+    } else if (ixFront >= 1024 && 2 * ixFront >= workList.size()) {
+      workList.erase(workList.begin(), workList.begin() + ixFront);
+      ixFront = 0;
+    }
     return ret;
   }
-};
-
 
-#define soft_check(e, ctx) if (!(e)) {outs() << "Failed: " << #e << ", " << ctx << "\n";}
-
-//////////////////////////////////////////////////////////////////////////////
+  size_t size() {
+    return workList.size() - ixFront;
+  }
+};
 
-static cl::opt<std::string> SourcesAndSinksFile("sources-and-sinks",
-                             cl::desc("File identifying sources and sinks"),
-                             cl::Required, cl::ValueRequired);
+/*****************************************************************************
+ * Function worklist ordered by the strongly connected components (SCCs) of
+ * the call graph.  SCCs are numbered bottom-up (callees before callers), and
+ * pop() always returns a function from the lowest-numbered SCC that has
+ * pending work, so each SCC is iterated to a fixpoint before any of its
+ * callers are analyzed.  Within an SCC, functions are also taken bottom-up,
+ * in the DFS postorder of its call edges.  Functions outside the call graph
+ * (declarations) are never scheduled.
+ *
+ * Globals do not merge SCCs: the functions that read a global are
+ * re-queued when its taint grows (see analyzeFunc).  They only order the
+ * SCCs, so that the SCCs writing a global come before those reading it
+ * whenever the call graph allows.
+ ****************************************************************************/
 
-static cl::opt<std::string> TaintCpFile("taint-copiers",
-                                        cl::desc("File identifying functions that copy taint from one entity to another"),
-                                        cl::Required, cl::ValueRequired);
+class SccWorkList {
+  public:
+  map<Function*, int> sccOfFunc;
+  DenseMap<Function*, unsigned> ixInScc; // position in its SCC
+  vector<vector<Function*>> sccs;
+  vector<set<int>> depSccsOf; // callees only
+  vector<vector<int>> dependentSccsOf;
+  vector<set<unsigned>> pendingOfScc; // positions in the SCC
+  set<int> pendingSccs;
+  size_t numPending = 0;
+  int lastScc = -1;
+
+  // Tarjan's algorithm over the nodes 0..succsOf.size()-1, iterative so
+  // that deep call chains cannot overflow the stack.  Tarjan emits each SCC
+  // only after every SCC reachable from it, which is exactly the
+  // callees-first order we want.  The members of each SCC are returned in
+  // DFS postorder.
+  static vector<vector<int>> findSccs(const vector<vector<int>>& succsOf) {
+    int numNodes = succsOf.size();
+    vector<int> index(numNodes, -1);
+    vector<int> lowlink(numNodes);
+    vector<int> postIndex(numNodes);
+    vector<char> onStack(numNodes);
+    vector<int> sccStack;
+    vector<vector<int>> sccs;
+    int nextIndex = 0;
+    int nextPostIndex = 0;
+    for (int root = 0; root < numNodes; root++) {
+      if (index[root] >= 0) {
+        continue;
+      }
+      vector<pair<int, size_t>> dfsStack; // node, position of its next successor
+      auto push = [&](int node) {
+        index[node] = lowlink[node] = nextIndex++;
+        sccStack.push_back(node);
+        onStack[node] = true;
+        dfsStack.push_back({node, 0});
+      };
+      push(root);
+      while (!dfsStack.empty()) {
+        int node = dfsStack.back().first;
+        size_t ixSucc = dfsStack.back().second++;
+        if (ixSucc < succsOf[node].size()) {
+          int succ = succsOf[node][ixSucc];
+          if (index[succ] < 0) {
+            push(succ);
+          } else if (onStack[succ]) {
+            lowlink[node] = min(lowlink[node], index[succ]);
+          }
+          continue;
+        }
+        postIndex[node] = nextPostIndex++;
+        if (lowlink[node] == index[node]) {
+          vector<int> scc;
+          int member;
+          do {
+            member = sccStack.back();
+            sccStack.pop_back();
+            onStack[member] = false;
+            scc.push_back(member);
+          } while (member != node);
+          std::sort(scc.begin(), scc.end(), [&](int lhs, int rhs) { return postIndex[lhs] < postIndex[rhs]; });
+          sccs.push_back(scc);
+        }
+        dfsStack.pop_back();
+        if (!dfsStack.empty()) {
+          int parent = dfsStack.back().first;
+          lowlink[parent] = min(lowlink[parent], lowlink[node]);
+        }
+      }
+    }
+    return sccs;
+  }
 
-static cl::opt<std::string> WrappersFile("wrappers",
-                             cl::desc("File identifying wrapper functions"),
-                             cl::ValueRequired);
+  // depsOf maps a function to its callees and to the globals it reads, and
+  // a global to the functions that may write it.
+  void build(const vector<Function*>& funcs, map<Value*, set<Value*>>& depsOf) {
+    DenseMap<Value*, int> ixOfFunc;
+    for (Function* func : funcs) {
+      ixOfFunc[func] = ixOfFunc.size();
+    }
+    // SCCs of the call graph, callees first.
+    vector<vector<int>> calleesOf(funcs.size());
+    for (size_t ixFunc = 0; ixFunc < funcs.size(); ixFunc++) {
+      for (Value* dep : depsOf[funcs[ixFunc]]) {
+        auto itIx = ixOfFunc.find(dep);
+        if (itIx != ixOfFunc.end()) {
+          calleesOf[ixFunc].push_back(itIx->second);
+        }
+      }
+      std::sort(calleesOf[ixFunc].begin(), calleesOf[ixFunc].end());
+    }
+    vector<vector<int>> callSccs = findSccs(calleesOf);
+    vector<int> callSccOf(funcs.size());
+    for (size_t ixCallScc = 0; ixCallScc < callSccs.size(); ixCallScc++) {
+      for (int ixFunc : callSccs[ixCallScc]) {
+        callSccOf[ixFunc] = ixCallScc;
+      }
+    }
 
-#if USE_OLD_PASS_MANAGER
-class TaintPass : public llvm::ModulePass
-#else
-class TaintPass : public llvm::PassInfoMixin<TaintPass>
-#endif
-{
-public:
-  #if USE_OLD_PASS_MANAGER
-  static char ID;
+    // Order the SCCs by the SCCs of the graph that also has the edges from
+    // the readers of globals to their writers; within those, callees first.
+    vector<vector<int>> depsOfCallScc(callSccs.size());
+    for (size_t ixCallScc = 0; ixCallScc < callSccs.size(); ixCallScc++) {
+      set<int> deps;
+      for (int ixFunc : callSccs[ixCallScc]) {
+        for (Value* dep : depsOf[funcs[ixFunc]]) {
+          if (isa<Function>(dep)) {
+            auto itIx = ixOfFunc.find(dep);
+            if (itIx != ixOfFunc.end()) {
+              deps.insert(callSccOf[itIx->second]);
+            }
+            continue;
+          }
+          for (Value* writer : depsOf[dep]) {
+            auto itIx = ixOfFunc.find(writer);
+            if (itIx != ixOfFunc.end()) {
+              deps.insert(callSccOf[itIx->second]);
+            }
+          }
+        }
+      }
+      deps.erase(ixCallScc);
+      depsOfCallScc[ixCallScc].assign(deps.begin(), deps.end());
+    }
+    for (vector<int>& group : findSccs(depsOfCallScc)) {
+      std::sort(group.begin(), group.end());
+      for (int ixCallScc : group) {
+        vector<Function*> scc;
+        for (int ixFunc : callSccs[ixCallScc]) {
+          sccOfFunc[funcs[ixFunc]] = sccs.size();
+          ixInScc[funcs[ixFunc]] = scc.size();
+          scc.push_back(funcs[ixFunc]);
+        }
+        sccs.push_back(scc);
+      }
+    }
+    pendingOfScc.resize(sccs.size());
+
+    // Condensed DAG of the SCCs, for the parallel scheduler.
+    depSccsOf.resize(sccs.size());
+    dependentSccsOf.resize(sccs.size());
+    for (size_t ixScc = 0; ixScc < sccs.size(); ixScc++) {
+      for (Function* func : sccs[ixScc]) {
+        for (Value* dep : depsOf[func]) {
+          Function* callee = dyn_cast<Function>(dep);
+          if (callee && sccOfFunc.count(callee)) {
+            depSccsOf[ixScc].insert(sccOfFunc[callee]);
+          }
+        }
+      }
+      depSccsOf[ixScc].erase(ixScc);
+      for (int ixDep : depSccsOf[ixScc]) {
+        dependentSccsOf[ixDep].push_back(ixScc);
+      }
+    }
+  }
 
-  TaintPass() : llvm::ModulePass(ID) { }
-  ~TaintPass(){ }
+  bool empty() {
+    return pendingSccs.empty();
+  }
 
-  virtual void getAnalysisUsage(AnalysisUsage &AU) const override {
-    AU.setPreservesCFG();
+  size_t size() {
+    return numPending;
   }
-  #endif
 
-  WorkList<Function*> funcWorkList;
-  unordered_map<Function*, set<Function*>> callersOfFunc;
+  void add(Function* func) {
+    auto itScc = sccOfFunc.find(func);
+    if (itScc == sccOfFunc.end()) {
+      return;
+    }
+    int ixScc = itScc->second;
+    if (!pendingOfScc[ixScc].insert(ixInScc[func]).second) {
+      return;
+    }
+    pendingSccs.insert(ixScc);
+    numPending++;
+  }
 
-  map<Function*, map<Sink_t, SensSrcSet_t>> funcFlowsBySink; // function summaries
-  set<Function*> taintCopiers;
+  // The lowest pending SCC at or above the last one popped: a sweep goes on
+  // up the call graph, and functions invalidated below it (the readers of
+  // globals that grew) wait for the next sweep.
+  set<int>::iterator nextPendingScc() {
+    auto itScc = pendingSccs.lower_bound(lastScc);
+    return (itScc == pendingSccs.end()) ? pendingSccs.begin() : itScc;
+  }
 
-  map<SrcOrSink_t, SrcOrSink_t*> scrinksInUse;
+  // Returns true if the next pop() starts a new bottom-up sweep.
+  bool startsNewRound() {
+    return !empty() && pendingSccs.lower_bound(lastScc) == pendingSccs.end();
+  }
 
-  map<Function*, vector<int>> sinksOfFunc;
-  map<Function*, vector<int>> sourcesOfFunc;
-  set<Function*> wrapperFuncs;
+  // The SCC that the next pop() will take a function from.
+  int nextScc() {
+    return *nextPendingScc();
+  }
 
-  map<Function*, vector<int>> funcArgSrcCat;
-  map<Function*, vector<int>> funcArgSinkCat;
-  map<Function*, int> funcRetCat;
-  set<Function*> knownExtFuncs;
-  set<Function*> unknownExtFuncs;
+  // Drops all pending work of an SCC, e.g., because its summaries have been
+  // loaded from the summary cache.
+  void dropScc(int ixScc) {
+    numPending -= pendingOfScc[ixScc].size();
+    pendingOfScc[ixScc].clear();
+    pendingSccs.erase(ixScc);
+    lastScc = ixScc;
+  }
 
-  SrcOrSink_t* storeScrink(SrcOrSink_t src) {
-    SrcOrSink_t* pSrc = scrinksInUse[src];
-    if (pSrc == nullptr) {
-      pSrc = new SrcOrSink_t(src);
-      scrinksInUse[src] = pSrc;
+  // The pending functions, in the order pop() would return them if no more
+  // were added.
+  vector<Function*> pendingFuncs() {
+    vector<Function*> funcs;
+    vector<int> order(nextPendingScc(), pendingSccs.end());
+    order.insert(order.end(), pendingSccs.begin(), nextPendingScc());
+    for (int ixScc : order) {
+      for (unsigned ixFunc : pendingOfScc[ixScc]) {
+        funcs.push_back(sccs[ixScc][ixFunc]);
+      }
     }
-    return pSrc;
+    return funcs;
   }
 
-  void dumpSrcOrSink(llvm::raw_ostream &os, const SrcOrSink_t &src, string* wrapperIndent) {
-    string funcName;
-    if (src.auxConst) {
-      string auxString = getStringFromConstantExpr(src.auxConst);
-      os << "{\"aux_file\":";
-      os << "\"" << auxString << "\"}";
-      return;
-    }
-    os << "{\"Func\":";
-    if (src.func) {
-      funcName = src.func->getName();
-      os << "\"" << funcName << "\"";
-    } else {
-      os << "\"null\"";
+  Function* pop() {
+    int ixScc = *nextPendingScc();
+    set<unsigned>& pending = pendingOfScc[ixScc];
+    Function* ret = sccs[ixScc][*pending.begin()];
+    pending.erase(pending.begin());
+    if (pending.empty()) {
+      pendingSccs.erase(ixScc);
     }
+    numPending--;
+    lastScc = ixScc;
+    return ret;
+  }
+};
 
-    os << ", \"aux\":\"" << getAuxName(src.auxType) << "\"";
 
-    bool is_wrapped = (src.wrapped && wrapperIndent != nullptr);
+/*****************************************************************************
+ * On-disk cache of function summaries, reused across runs.  The unit of
+ * caching is an SCC of the call graph: its key is a hash of the IR of its
+ * functions, of the summaries of the functions they call, and of the
+ * configuration files, so an SCC whose key is found can be loaded instead of
+ * analyzed.  Summaries refer to IR objects, so they are written by position:
+ * functions by name, instructions by their function and index within it.
+ * The same format is used for the checkpoints of the analysis.
+ ****************************************************************************/
 
-    if (!is_wrapped) {
-      os << ", \"arg\":" << src.ixArg;
+class SummaryCache {
+  public:
+  struct CachedSummary {
+    Function* func;
+    vector<pair<Sink_t, SensSrcSet_t>> flowsBySink;
+  };
+
+  string dir;
+  string configHash;
+  Module* module = nullptr;
+  DenseMap<Function*, vector<Instruction*>> instsOf;
+  DenseMap<Instruction*, unsigned> ixOfInst;
+  DenseMap<Function*, string> irHashOf;
+
+  bool enabled() const {
+    return !dir.empty();
+  }
+
+  // 'mode' covers options that change the analysis itself.  Without a
+  // cacheDir, only checkpoints can be read and written.
+  void init(Module& M, const string& cacheDir, const vector<string>& configFiles, const string& mode) {
+    if (cacheDir != "") {
+      if (std::error_code err = sys::fs::create_directories(cacheDir)) {
+        errs() << "Cannot create summary cache directory '" << cacheDir << "': " << err.message() << "\n";
+      } else {
+        dir = cacheDir;
+      }
     }
-    //if (src.auxConst) {
-    //  os << ", \"filename\":" << src.ixArg;
-    //}
-    os << ", \"callsite\": ";
-    if (src.callsite) {
-      write_file_line_col(src.callsite);
-      vector<int>& argCats = funcArgSinkCat[src.func];
-      for (int ixArg=0; ixArg < argCats.size(); ixArg++) {
-        if (argCats[ixArg] != AUX_TYPE_FILE) {
-          continue;
-        }
-        Value* arg = src.callsite->getArgOperand(ixArg);
-        //dump(arg);
-        llvm::LoadInst* load = dyn_cast<LoadInst>(arg);
-        if (load && dyn_cast<GlobalValue>(load->getPointerOperand())) {
-          vector<string> std_files = {"stdin", "stdout", "stderr"};
-          for (string sf : std_files) {
-            if (load->getPointerOperand()->getName() == sf) {
-              //load->getPointerOperand()->dump();
-              outs() << ", \"FILE*\":\"" << sf << "\"";
-            }
-          }
+    module = &M;
+    string config = CACHE_FORMAT + mode + "\n";
+    for (const string& filename : configFiles) {
+      config += "file " + filename + "\n";
+      if (auto buffer = MemoryBuffer::getFile(filename)) {
+        config += md5Hex((*buffer)->getBuffer()) + "\n";
+      }
+    }
+    configHash = md5Hex(config);
+    for (Function& F : M) {
+      if (F.isDeclaration()) {
+        continue;
+      }
+      vector<Instruction*>& insts = instsOf[&F];
+      for (auto &B : F) {
+        for (auto &I : B) {
+          ixOfInst[&I] = insts.size();
+          insts.push_back(&I);
         }
-        //outs() << arg;
       }
+      irHashOf[&F] = hashFunctionIR(F);
+    }
+  }
 
-      //src.callsite->print(os);
-    } else {
-      os << "null";
+  // Hash of F's summary, for the keys of its callers' SCCs.  Memoized per
+  // summary version; returns "" if the summary cannot be written.
+  string summaryHash(Function* F, const FuncSummary_t& summary) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto itHash = summaryHashOf.find(F);
+    if (itHash != summaryHashOf.end() && itHash->second.first == summary.version) {
+      return itHash->second.second;
     }
+    string text;
+    string hash = writeSummary(summary, text) ? md5Hex(text) : "";
+    summaryHashOf[F] = {summary.version, hash};
+    return hash;
+  }
 
-    if (is_wrapped) {
-      os << ", \"wrapped\": \n" << *wrapperIndent;
+  void store(const string& key, const vector<Function*>& funcs, const DenseMap<Function*, FuncSummary_t>& summaries) {
+    string text = CACHE_FORMAT;
+    for (Function* F : funcs) {
+      string summaryText;
+      if (!writeSummary(summaries.find(F)->second, summaryText)) {
+        return;
+      }
+      raw_string_ostream os(text);
+      os << "func ";
+      writeName(os, F->getName());
+      os << "\n" << summaryText;
+    }
+    text += "end\n";
+    // Write to a temporary file first, so that concurrent runs sharing the
+    // directory never see a partial entry.
+    int fd;
+    SmallString<128> tmpPath;
+    if (sys::fs::createUniqueFile(dir + "/tmp-%%%%%%%%", fd, tmpPath)) {
+      return;
+    }
+    {
+      raw_fd_ostream os(fd, /*shouldClose=*/true);
+      os << text;
+    }
+    if (sys::fs::rename(tmpPath, pathOf(key))) {
+      sys::fs::remove(tmpPath);
+    }
+  }
+
+  // Reads the entry for key, which must only hold summaries of funcs.
+  // Returns false, leaving nothing half-applied, if there is no usable entry.
+  bool load(const string& key, const vector<Function*>& funcs, vector<CachedSummary>& summaries) {
+    auto buffer = MemoryBuffer::getFile(pathOf(key));
+    if (!buffer) {
+      return false;
+    }
+    StringRef text = (*buffer)->getBuffer();
+    if (!text.consume_front(CACHE_FORMAT)) {
+      return false;
+    }
+    vector<ScrinkId> idOfIx; // the scrink table of the current function
+    while (!text.empty()) {
+      StringRef line;
+      std::tie(line, text) = text.split('\n');
+      if (line == "end") {
+        return text.empty();
+      } else if (line.consume_front("func ")) {
+        StringRef name;
+        if (!readName(line, name) || !line.empty()) {
+          return false;
+        }
+        Function* func = module->getFunction(name);
+        if (std::find(funcs.begin(), funcs.end(), func) == funcs.end()) {
+          return false;
+        }
+        summaries.push_back({func});
+        idOfIx.clear();
+      } else if (!summaries.empty() && line.consume_front("scrink ")) {
+        SrcOrSink_t scrink;
+        if (!readScrink(line, scrink) || !line.empty()) {
+          return false;
+        }
+        idOfIx.push_back(scrinkTable.intern(scrink));
+      } else if (!summaries.empty() && line.consume_front("sink ")) {
+        unsigned ix;
+        if (line.consumeInteger(10, ix) || ix >= idOfIx.size()) {
+          return false;
+        }
+        SensSrcSet_t sources;
+        while (line.consume_front(" ")) {
+          unsigned ixSrc;
+          if (line.consumeInteger(10, ixSrc) || ixSrc >= idOfIx.size()) {
+            return false;
+          }
+          sources.ids.set(idOfIx[ixSrc]);
+        }
+        if (!line.empty()) {
+          return false;
+        }
+        summaries.back().flowsBySink.push_back({scrinkTable[idOfIx[ix]], sources});
+      } else {
+        return false;
+      }
+    }
+    return false; // truncated
+  }
+
+  // The state of an interrupted analysis: the summaries of the functions of
+  // the SCCs started, the taint of the globals with the functions that may
+  // write them, the functions still pending in the order they would have
+  // been analyzed, and one member of each SCC that wrote taint to globals or
+  // was loaded from the summary cache.
+  struct Checkpoint {
+    vector<CachedSummary> summaries;
+    vector<pair<GlobalVariable*, SensSrcSet_t>> globalTaint;
+    vector<pair<Function*, GlobalVariable*>> gvarWriters;
+    vector<Function*> pending;
+    vector<Function*> wroteGlobals;
+    vector<Function*> fromCache;
+
+    vector<GlobalVariable*> staleGlobals;
+  };
+
+  // Writes the checkpoint to a temporary file renamed to path, so that a
+  // run killed while writing leaves the previous checkpoint.  The functions
+  // are written with the hash of their IR.
+  bool writeCheckpoint(const string& path, const vector<Function*>& funcs,
+                       const DenseMap<Function*, FuncSummary_t>& summaries,
+                       const DenseMap<Value*, SensSrcSet_t>& globalTaint,
+                       const vector<Function*>& pending, const vector<Function*>& wroteGlobals,
+                       const vector<Function*>& fromCache) {
+    string text = CHECKPOINT_FORMAT;
+    raw_string_ostream os(text);
+    os << "config " << configHash << "\n";
+    for (Function* F : funcs) {
+      string summaryText;
+      if (!F->hasName() || !writeSummary(summaries.find(F)->second, summaryText)) {
+        return false;
+      }
+      os << "func ";
+      writeName(os, F->getName());
+      os << " " << irHashOf.lookup(F) << "\n" << summaryText;
+    }
+    for (auto const& [loc, sources] : globalTaint) {
+      GlobalVariable* gv = dyn_cast<GlobalVariable>(loc);
+      if (!gv || !gv->hasName()) {
+        return false;
+      }
+      os << "global ";
+      writeName(os, gv->getName());
+      os << "\n";
+      // Its writers by name, so that the file is the same every run.
+      vector<Function*> writers(fnsWritingGvar[gv].begin(), fnsWritingGvar[gv].end());
+      std::sort(writers.begin(), writers.end(),
+                [](Function* lhs, Function* rhs) { return lhs->getName() < rhs->getName(); });
+      for (Function* writer : writers) {
+        if (!writer->hasName()) {
+          return false;
+        }
+        os << "writer ";
+        writeName(os, writer->getName());
+        os << "\n";
+      }
+      for (const SensSrc_t& src : sources) {
+        os << "scrink ";
+        if (!writeScrink(os, src)) {
+          return false;
+        }
+        os << "\n";
+      }
+    }
+    for (auto [keyword, funcList] : {pair{"pending", &pending}, {"wrote-globals", &wroteGlobals},
+                                     {"from-cache", &fromCache}}) {
+      for (Function* F : *funcList) {
+        os << keyword << " ";
+        writeName(os, F->getName());
+        os << "\n";
+      }
+    }
+    os << "end\n";
+    int fd;
+    SmallString<128> tmpPath;
+    if (sys::fs::createUniqueFile(path + ".tmp-%%%%%%%%", fd, tmpPath)) {
+      return false;
+    }
+    {
+      raw_fd_ostream fileOs(fd, /*shouldClose=*/true);
+      fileOs << os.str();
+    }
+    if (sys::fs::rename(tmpPath, path)) {
+      sys::fs::remove(tmpPath);
+      return false;
+    }
+    return true;
+  }
+
+  // Reads a checkpoint of this module and configuration.  Returns false,
+  // with the reason in 'error', if it can't be used.  With 'partial', as
+  // for the summaries of a previous run, the summaries of functions that
+  // changed are skipped instead, and so is the taint of globals that can't
+  // be read back; those globals are returned in checkpoint.staleGlobals.
+  bool readCheckpoint(const string& path, Checkpoint& checkpoint, string& error, bool partial = false) {
+    auto buffer = MemoryBuffer::getFile(path);
+    if (!buffer) {
+      error = buffer.getError().message();
+      return false;
+    }
+    StringRef text = (*buffer)->getBuffer();
+    if (!text.consume_front(CHECKPOINT_FORMAT)) {
+      error = "not a checkpoint";
+      return false;
+    }
+    error = "malformed";
+    vector<ScrinkId> idOfIx; // the scrink table of the current function
+    SensSrcSet_t* globalSources = nullptr;
+    bool skipping = false; // the lines of a skipped function or global
+    // Drops the function or global being read, if partial.
+    auto skip = [&]() {
+      if (!partial || skipping) {
+        return partial;
+      }
+      if (globalSources) {
+        checkpoint.staleGlobals.push_back(checkpoint.globalTaint.back().first);
+        checkpoint.globalTaint.pop_back();
+        globalSources = nullptr;
+      } else if (!checkpoint.summaries.empty()) {
+        checkpoint.summaries.pop_back();
+      }
+      skipping = true;
+      return true;
+    };
+    while (!text.empty()) {
+      StringRef line;
+      std::tie(line, text) = text.split('\n');
+      StringRef name;
+      if (line == "end") {
+        error = "";
+        return text.empty();
+      } else if (line.consume_front("config ")) {
+        if (line != configHash) {
+          error = "made with other configuration files or options";
+          return false;
+        }
+      } else if (line.consume_front("func ")) {
+        if (!readName(line, name) || !line.consume_front(" ")) {
+          return false;
+        }
+        globalSources = nullptr;
+        skipping = false;
+        Function* func = module->getFunction(name);
+        if (!func || func->isDeclaration() || irHashOf.lookup(func) != line) {
+          error = "function '" + name.str() + "' has changed";
+          if (!partial) {
+            return false;
+          }
+          skipping = true;
+          continue;
+        }
+        checkpoint.summaries.push_back({func});
+        idOfIx.clear();
+      } else if (line.consume_front("global ")) {
+        if (!readName(line, name) || !line.empty()) {
+          return false;
+        }
+        skipping = false;
+        GlobalVariable* gv = module->getNamedGlobal(name);
+        if (!gv) {
+          if (!skip()) {
+            return false;
+          }
+          continue;
+        }
+        checkpoint.globalTaint.push_back({gv, {}});
+        globalSources = &checkpoint.globalTaint.back().second;
+      } else if (skipping && (line.startswith("scrink ") || line.startswith("sink ") ||
+                              line.startswith("writer "))) {
+        continue;
+      } else if (globalSources && line.consume_front("writer ")) {
+        if (!readName(line, name) || !line.empty()) {
+          return false;
+        }
+        // A global written by a function that is gone may hold its taint.
+        Function* writer = module->getFunction(name);
+        if (writer && !writer->isDeclaration()) {
+          checkpoint.gvarWriters.push_back({writer, checkpoint.globalTaint.back().first});
+        } else if (!skip()) {
+          return false;
+        }
+      } else if (line.consume_front("scrink ")) {
+        SrcOrSink_t scrink;
+        if (!readScrink(line, scrink) || !line.empty()) {
+          if (!skip()) {
+            return false;
+          }
+        } else if (globalSources) {
+          globalSources->insert(scrink);
+        } else if (!checkpoint.summaries.empty()) {
+          idOfIx.push_back(scrinkTable.intern(scrink));
+        } else {
+          return false;
+        }
+      } else if (!checkpoint.summaries.empty() && !globalSources && line.consume_front("sink ")) {
+        unsigned ix;
+        if (line.consumeInteger(10, ix) || ix >= idOfIx.size()) {
+          return false;
+        }
+        SensSrcSet_t sources;
+        while (line.consume_front(" ")) {
+          unsigned ixSrc;
+          if (line.consumeInteger(10, ixSrc) || ixSrc >= idOfIx.size()) {
+            return false;
+          }
+          sources.ids.set(idOfIx[ixSrc]);
+        }
+        if (!line.empty()) {
+          return false;
+        }
+        checkpoint.summaries.back().flowsBySink.push_back({scrinkTable[idOfIx[ix]], sources});
+      } else if (vector<Function*>* funcList = line.consume_front("pending ") ? &checkpoint.pending
+                                               : line.consume_front("wrote-globals ") ? &checkpoint.wroteGlobals
+                                               : line.consume_front("from-cache ") ? &checkpoint.fromCache
+                                               : nullptr) {
+        Function* func;
+        if (!readName(line, name) || !line.empty()) {
+          return false;
+        }
+        if ((func = module->getFunction(name))) {
+          funcList->push_back(func);
+        } else if (!partial) {
+          return false;
+        }
+      } else {
+        return false;
+      }
+    }
+    error = "truncated";
+    return false;
+  }
+
+  // Hash of a set of sources, e.g., the taint of a global; "" if the set
+  // cannot be written.
+  string sourcesHash(const SensSrcSet_t& sources) {
+    vector<string> lines;
+    for (const SensSrc_t& src : sources) {
+      string line;
+      raw_string_ostream os(line);
+      if (!writeScrink(os, src)) {
+        return "";
+      }
+      os << "\n";
+      lines.push_back(os.str());
+    }
+    std::sort(lines.begin(), lines.end());
+    string text;
+    for (const string& line : lines) {
+      text += line;
+    }
+    return md5Hex(text);
+  }
+
+  static string md5Hex(StringRef text) {
+    MD5 hasher;
+    hasher.update(text);
+    MD5::MD5Result result;
+    hasher.final(result);
+    return result.digest().str().str();
+  }
+
+  private:
+  static constexpr const char* CACHE_FORMAT = "dmc-summary-cache 1\n";
+  static constexpr const char* CHECKPOINT_FORMAT = "dmc-checkpoint 3\n";
+
+  std::mutex mutex; // guards summaryHashOf
+  DenseMap<Function*, pair<unsigned, string>> summaryHashOf;
+
+  string pathOf(const string& key) {
+    return dir + "/" + key + ".sum";
+  }
+
+  // Everything in F that the analysis looks at, with values inside F
+  // numbered rather than named.  Debug info is left out, so edits that only
+  // move code around do not invalidate the cache.
+  string hashFunctionIR(Function& F) {
+    DenseMap<Value*, unsigned> localIx;
+    for (auto &Arg : F.args()) {
+      localIx[&Arg] = localIx.size();
+    }
+    for (auto &B : F) {
+      localIx[&B] = localIx.size();
+      for (auto &I : B) {
+        localIx[&I] = localIx.size();
+      }
+    }
+    string text;
+    raw_string_ostream os(text);
+    writeName(os, F.getName());
+    os << " " << *F.getFunctionType() << "\n";
+    for (auto &B : F) {
+      os << "bb\n";
+      for (auto &I : B) {
+        os << I.getOpcodeName() << " " << *I.getType();
+        for (Value* op : I.operands()) {
+          os << " ";
+          if (isa<Argument>(op) || isa<BasicBlock>(op) || isa<Instruction>(op)) {
+            os << "%" << localIx.lookup(op);
+          } else if (isa<MetadataAsValue>(op)) {
+            os << "md";
+          } else if (Constant* constant = dyn_cast<Constant>(op)) {
+            writeConstant(os, constant);
+          } else {
+            op->printAsOperand(os, true, module);
+          }
+        }
+        os << "\n";
+      }
+    }
+    return md5Hex(os.str());
+  }
+
+  void writeConstant(raw_ostream& os, Constant* constant) {
+    constant->printAsOperand(os, true, module);
+    // The contents of constant strings decide which of them are filenames.
+    if (GlobalVariable* gv = dyn_cast<GlobalVariable>(constant)) {
+      if (gv->isConstant() && gv->hasInitializer()) {
+        os << "=";
+        gv->getInitializer()->printAsOperand(os, true, module);
+      }
+      return;
+    }
+    if (isa<GlobalValue>(constant)) {
+      return;
+    }
+    for (Value* op : constant->operands()) {
+      if (Constant* opConstant = dyn_cast<Constant>(op)) {
+        os << "{";
+        writeConstant(os, opConstant);
+        os << "}";
+      }
+    }
+  }
+
+  // A table of the summary's scrinks, one per line, followed by one line per
+  // sink listing it and its sources by their position in the table.  The
+  // table is sorted, so that the text depends neither on pointer values nor
+  // on the order of the analysis.
+  bool writeSummary(const FuncSummary_t& summary, string& text) {
+    vector<string> scrinkTexts;
+    vector<pair<unsigned, vector<unsigned>>> flows; // positions in scrinkTexts, before sorting
+    DenseMap<ScrinkId, unsigned> ixOfId;
+    for (auto const& [sink, sources] : summary) {
+      string sinkText;
+      raw_string_ostream sinkOs(sinkText);
+      if (!writeScrink(sinkOs, sink)) {
+        return false;
+      }
+      flows.push_back({(unsigned)scrinkTexts.size(), {}});
+      scrinkTexts.push_back(sinkOs.str());
+      for (ScrinkId id : sources.ids) {
+        auto [itIx, isNew] = ixOfId.insert({id, (unsigned)scrinkTexts.size()});
+        if (isNew) {
+          string srcText;
+          raw_string_ostream os(srcText);
+          if (!writeScrink(os, scrinkTable[id])) {
+            return false;
+          }
+          scrinkTexts.push_back(os.str());
+        }
+        flows.back().second.push_back(itIx->second);
+      }
+    }
+    vector<unsigned> order(scrinkTexts.size());
+    for (unsigned ix = 0; ix < order.size(); ix++) {
+      order[ix] = ix;
+    }
+    std::sort(order.begin(), order.end(), [&](unsigned lhs, unsigned rhs) {
+      return scrinkTexts[lhs] < scrinkTexts[rhs];
+    });
+    // A sink that is also a source appears twice, so equal texts share a position.
+    vector<unsigned> sortedIxOf(order.size());
+    unsigned numDistinct = 0;
+    for (unsigned rank = 0; rank < order.size(); rank++) {
+      if (rank == 0 || scrinkTexts[order[rank]] != scrinkTexts[order[rank - 1]]) {
+        text += "scrink " + scrinkTexts[order[rank]] + "\n";
+        numDistinct++;
+      }
+      sortedIxOf[order[rank]] = numDistinct - 1;
+    }
+    vector<string> sinkLines;
+    for (auto& [ixSink, ixSources] : flows) {
+      vector<unsigned> sortedSources;
+      for (unsigned ixSrc : ixSources) {
+        sortedSources.push_back(sortedIxOf[ixSrc]);
+      }
+      std::sort(sortedSources.begin(), sortedSources.end());
+      string line = "sink " + std::to_string(sortedIxOf[ixSink]);
+      for (unsigned ixSrc : sortedSources) {
+        line += " " + std::to_string(ixSrc);
+      }
+      sinkLines.push_back(line + "\n");
+    }
+    std::sort(sinkLines.begin(), sinkLines.end());
+    for (const string& line : sinkLines) {
+      text += line;
+    }
+    return true;
+  }
+
+  void writeName(raw_ostream& os, StringRef name) {
+    os << name.size() << ":" << name;
+  }
+
+  bool readName(StringRef& text, StringRef& name) {
+    size_t len;
+    if (text.consumeInteger(10, len) || !text.consume_front(":") || text.size() < len) {
+      return false;
+    }
+    name = text.take_front(len);
+    text = text.drop_front(len);
+    return true;
+  }
+
+  bool writeInst(raw_ostream& os, Instruction* inst) {
+    auto itIx = ixOfInst.find(inst);
+    if (itIx == ixOfInst.end() || !inst->getFunction()->hasName()) {
+      return false;
+    }
+    writeName(os, inst->getFunction()->getName());
+    os << "#" << itIx->second;
+    return true;
+  }
+
+  bool readInst(StringRef& text, Instruction*& inst) {
+    StringRef funcName;
+    unsigned ix;
+    if (!readName(text, funcName) || !text.consume_front("#") || text.consumeInteger(10, ix)) {
+      return false;
+    }
+    auto itInsts = instsOf.find(module->getFunction(funcName));
+    if (itInsts == instsOf.end() || ix >= itInsts->second.size()) {
+      return false;
+    }
+    inst = itInsts->second[ix];
+    return true;
+  }
+
+  // A scrink is written as "(func ixArg callsite auxType wrapped auxConst)",
+  // with "-" for null fields.  An aux constant is written as the first
+  // instruction operand (by function name and index) that uses it.
+  bool writeScrink(raw_ostream& os, const SrcOrSink_t& scrink) {
+    os << "(";
+    if (scrink.func) {
+      if (!scrink.func->hasName()) {
+        return false;
+      }
+      writeName(os, scrink.func->getName());
+    } else {
+      os << "-";
+    }
+    os << " " << scrink.ixArg << " ";
+    if (scrink.callsite) {
+      if (!writeInst(os, scrink.callsite)) {
+        return false;
+      }
+    } else {
+      os << "-";
+    }
+    os << " " << scrink.auxType << " ";
+    if (scrink.wrapped) {
+      if (!writeScrink(os, *scrink.wrapped)) {
+        return false;
+      }
+    } else {
+      os << "-";
+    }
+    os << " ";
+    if (scrink.auxConst) {
+      const Use* firstUse = nullptr;
+      for (const Use& use : scrink.auxConst->uses()) {
+        Instruction* user = dyn_cast<Instruction>(use.getUser());
+        if (!user || !ixOfInst.count(user)) {
+          continue;
+        }
+        if (!firstUse || useOrder(use) < useOrder(*firstUse)) {
+          firstUse = &use;
+        }
+      }
+      if (!firstUse || !writeInst(os, cast<Instruction>(firstUse->getUser()))) {
+        return false;
+      }
+      os << "/" << firstUse->getOperandNo();
+    } else {
+      os << "-";
+    }
+    os << ")";
+    return true;
+  }
+
+  std::tuple<StringRef, unsigned, unsigned> useOrder(const Use& use) {
+    Instruction* user = cast<Instruction>(use.getUser());
+    return {user->getFunction()->getName(), ixOfInst.lookup(user), use.getOperandNo()};
+  }
+
+  bool readScrink(StringRef& text, SrcOrSink_t& scrink) {
+    scrink = {};
+    if (!text.consume_front("(")) {
+      return false;
+    }
+    if (!text.consume_front("-")) {
+      StringRef name;
+      if (!readName(text, name) || !(scrink.func = module->getFunction(name))) {
+        return false;
+      }
+    }
+    if (!text.consume_front(" ") || text.consumeInteger(10, scrink.ixArg) || !text.consume_front(" ")) {
+      return false;
+    }
+    if (!text.consume_front("-")) {
+      Instruction* inst;
+      if (!readInst(text, inst) || !(scrink.callsite = dyn_cast<CallBase>(inst))) {
+        return false;
+      }
+    }
+    if (!text.consume_front(" ") || text.consumeInteger(10, scrink.auxType) || !text.consume_front(" ")) {
+      return false;
+    }
+    if (!text.consume_front("-")) {
+      SrcOrSink_t wrapped;
+      if (!readScrink(text, wrapped)) {
+        return false;
+      }
+      scrink.wrapped = &scrinkTable[scrinkTable.intern(wrapped)];
+    }
+    if (!text.consume_front(" ")) {
+      return false;
+    }
+    if (!text.consume_front("-")) {
+      Instruction* inst;
+      unsigned ixOp;
+      if (!readInst(text, inst) || !text.consume_front("/") || text.consumeInteger(10, ixOp) ||
+          ixOp >= inst->getNumOperands()) {
+        return false;
+      }
+      scrink.auxConst = inst->getOperand(ixOp);
+    }
+    return text.consume_front(")");
+  }
+};
+
+
+/*****************************************************************************
+ * Spec database, compiled from the sources-and-sinks and taint-copiers files
+ * by compile_spec.py (see there for the layout).  The file is mapped, not
+ * parsed: a function is looked up by the perfect hash of its name, so a
+ * run's cost is proportional to the module rather than to the spec.
+ ****************************************************************************/
+
+#define SPEC_DB_MAGIC "DMCS"
+#define SPEC_DB_VERSION 1
+#define SPEC_DB_NONE UINT32_MAX
+#define SPEC_CAT_SRC 1
+#define SPEC_CAT_SINK 2
+#define SPEC_CAT_FILE 4
+#define SPEC_CAT_PRESENT 8
+
+class SpecDb {
+  public:
+  enum Section {
+    SPEC_DISP, SPEC_SLOTS, SPEC_ENTRIES, SPEC_RECORDS,
+    COPIER_DISP, COPIER_SLOTS, COPIER_ENTRIES, COPIER_EDGES,
+    STR_OFFSETS, STR_DATA, ARG_CATS, NUM_SECTIONS
+  };
+  // Words per element of each section
+  static constexpr uint32_t widthOf[NUM_SECTIONS] = {1, 1, 3, 3, 1, 1, 3, 2, 1, 0, 0};
+
+  struct Record {
+    uint8_t retCat;
+    ArrayRef<uint8_t> argCats;
+  };
+
+  std::unique_ptr<MemoryBuffer> buffer;
+  uint32_t numSpecLines = 0;
+
+  // Returns false, with the reason in 'error', if path is not a usable
+  // spec database.
+  bool open(const string& path, string& error) {
+    auto bufOrErr = MemoryBuffer::getFile(path, false, false);
+    if (!bufOrErr) {
+      error = "cannot read spec database '" + path + "': " + bufOrErr.getError().message();
+      return false;
+    }
+    buffer = std::move(*bufOrErr);
+    size_t headerSize = 4 * (3 + 2 * NUM_SECTIONS);
+    if (buffer->getBufferSize() < headerSize || !buffer->getBuffer().startswith(SPEC_DB_MAGIC) ||
+        word(4) != SPEC_DB_VERSION) {
+      error = "'" + path + "' is not a spec database of version " + to_string(SPEC_DB_VERSION);
+      buffer.reset();
+      return false;
+    }
+    numSpecLines = word(8);
+    for (int s = 0; s < NUM_SECTIONS; s++) {
+      uint64_t size = (s == STR_OFFSETS) ? 4 * (uint64_t(count(STR_OFFSETS)) + 1)
+        : (widthOf[s] == 0) ? count(Section(s)) : 4 * uint64_t(count(Section(s))) * widthOf[s];
+      if (offset(Section(s)) % 4 != 0 || offset(Section(s)) + size > buffer->getBufferSize()) {
+        error = "spec database '" + path + "' is truncated";
+        buffer.reset();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // The records of the sources-and-sinks lines of 'name', empty if none.
+  vector<Record> specsOf(StringRef name) const {
+    vector<Record> records;
+    uint32_t ixEntry = find(SPEC_DISP, SPEC_SLOTS, SPEC_ENTRIES, name);
+    if (ixEntry == SPEC_DB_NONE) {
+      return records;
+    }
+    uint32_t first = element(SPEC_ENTRIES, ixEntry, 1);
+    uint32_t num = element(SPEC_ENTRIES, ixEntry, 2);
+    for (uint32_t ix = first; ix < first + num && ix < count(SPEC_RECORDS); ix++) {
+      uint32_t ixArg = element(SPEC_RECORDS, ix, 1);
+      uint32_t numArgs = element(SPEC_RECORDS, ix, 2);
+      if (uint64_t(ixArg) + numArgs > count(ARG_CATS)) {
+        continue;
+      }
+      const uint8_t* cats = (const uint8_t*)buffer->getBufferStart() + offset(ARG_CATS) + ixArg;
+      records.push_back({uint8_t(element(SPEC_RECORDS, ix, 0)), ArrayRef<uint8_t>(cats, numArgs)});
+    }
+    return records;
+  }
+
+  uint32_t numCopiers() const {
+    return count(COPIER_ENTRIES);
+  }
+
+  StringRef copierName(uint32_t ixCopier) const {
+    return str(element(COPIER_ENTRIES, ixCopier, 0));
+  }
+
+  uint32_t findCopier(StringRef name) const {
+    return find(COPIER_DISP, COPIER_SLOTS, COPIER_ENTRIES, name);
+  }
+
+  // The {sink argument, source argument} edges of a copier
+  vector<pair<int, int>> copierEdges(uint32_t ixCopier) const {
+    vector<pair<int, int>> edges;
+    uint32_t first = element(COPIER_ENTRIES, ixCopier, 1);
+    uint32_t num = element(COPIER_ENTRIES, ixCopier, 2);
+    for (uint32_t ix = first; ix < first + num && ix < count(COPIER_EDGES); ix++) {
+      edges.push_back({int(element(COPIER_EDGES, ix, 0)), int(element(COPIER_EDGES, ix, 1))});
+    }
+    return edges;
+  }
+
+  // FNV-1a with MurmurHash3's finalizer; must match hash_name in
+  // compile_spec.py.
+  static uint32_t hashName(StringRef name, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (unsigned char c : name) {
+      h = (h ^ c) * 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+  }
+
+  private:
+  uint32_t word(uint64_t byteOffset) const {
+    return support::endian::read32le(buffer->getBufferStart() + byteOffset);
+  }
+
+  uint32_t offset(Section s) const {
+    return word(12 + 8 * s);
+  }
+
+  uint32_t count(Section s) const {
+    return word(16 + 8 * s);
+  }
+
+  uint32_t element(Section s, uint32_t ix, uint32_t field) const {
+    return word(offset(s) + 4 * (uint64_t(ix) * widthOf[s] + field));
+  }
+
+  StringRef str(uint32_t ix) const {
+    if (ix >= count(STR_OFFSETS)) {
+      return "";
+    }
+    uint32_t begin = element(STR_OFFSETS, ix, 0);
+    uint32_t end = element(STR_OFFSETS, ix + 1, 0);
+    if (begin > end || end > count(STR_DATA)) {
+      return "";
+    }
+    return StringRef(buffer->getBufferStart() + offset(STR_DATA) + begin, end - begin);
+  }
+
+  // Index of the entry named 'name', or SPEC_DB_NONE
+  uint32_t find(Section disp, Section slots, Section entries, StringRef name) const {
+    if (count(disp) == 0 || count(slots) == 0) {
+      return SPEC_DB_NONE;
+    }
+    uint32_t d = element(disp, hashName(name, 0) % count(disp), 0);
+    uint32_t ixEntry = element(slots, hashName(name, d) % count(slots), 0);
+    if (ixEntry >= count(entries) || str(element(entries, ixEntry, 0)) != name) {
+      return SPEC_DB_NONE;
+    }
+    return ixEntry;
+  }
+};
+
+
+/*****************************************************************************
+ * Instrumentation for -taint-stats and -taint-stats-json: a timer for each
+ * phase of the pass, and counters of the analysis, per function and in
+ * total.  The phases run on the main thread; analyzeFunc calls, which may
+ * run concurrently, only update the counters of their own function.
+ ****************************************************************************/
+
+class PassStats {
+  public:
+  enum Phase {
+    SPECS, CALL_GRAPH, SCHEDULING, SUMMARY_CACHE, ANALYSIS, PRINT_SUMMARIES, PRINT_FLOWS, NUM_PHASES
+  };
+  static constexpr const char* phaseNames[NUM_PHASES][2] = {
+    {"specs", "Reading the sources, sinks and copiers"},
+    {"call_graph", "Building the dependency graph"},
+    {"scheduling", "Finding wrappers, pruning and SCCs"},
+    {"summary_cache", "Hashing and storing cached summaries"},
+    {"analysis", "Analyzing functions"},
+    {"print_summaries", "Printing summaries"},
+    {"print_flows", "Printing flows"},
+  };
+
+  struct FuncStats {
+    unsigned numAnalyses = 0;
+    uint64_t numInstVisits = 0;  // instructions taken off the worklist
+    uint64_t numUnions = 0;      // taint sets unioned into another
+    size_t peakSummarySize = 0;  // sources, over all the sinks
+    double seconds = 0;
+  };
+
+  bool enabled = false;
+  TimerGroup group{"taint", "Taint pass"};
+  Timer timers[NUM_PHASES];
+  DenseMap<Function*, FuncStats> statsOf; // every defined function
+  // The analysis time of the slowest chain of SCCs that depend on each
+  // other; the total analysis time over it bounds the -taint-threads speedup.
+  double criticalPathSeconds = 0;
+
+  void init(Module& M, bool enable) {
+    enabled = enable;
+    if (!enabled) {
+      return;
+    }
+    for (int phase = 0; phase < NUM_PHASES; phase++) {
+      timers[phase].init(phaseNames[phase][0], phaseNames[phase][1], group);
+    }
+    for (Function& F : M) {
+      if (!F.isDeclaration()) {
+        statsOf[&F];
+      }
+    }
+  }
+
+  // For TimeRegion: null if disabled
+  Timer* timer(Phase phase) {
+    return enabled ? &timers[phase] : nullptr;
+  }
+
+  void start(Phase phase) {
+    if (enabled) {
+      timers[phase].startTimer();
+    }
+  }
+
+  void stop(Phase phase) {
+    if (enabled) {
+      timers[phase].stopTimer();
+    }
+  }
+
+  FuncStats* of(Function* F) {
+    return enabled ? &statsOf.find(F)->second : nullptr;
+  }
+
+  // Writes the JSON report to jsonFile, if any, then prints the report to
+  // stderr if 'print'.
+  void report(const string& jsonFile, bool print) {
+    if (!enabled) {
+      return;
+    }
+    vector<pair<Function*, FuncStats*>> funcs;
+    FuncStats total;
+    size_t numFuncs = 0;
+    unsigned maxAnalyses = 0;
+    for (auto& [F, stats] : statsOf) {
+      if (stats.numAnalyses == 0) {
+        continue;
+      }
+      funcs.push_back({F, &stats});
+      numFuncs++;
+      total.numAnalyses += stats.numAnalyses;
+      total.numInstVisits += stats.numInstVisits;
+      total.numUnions += stats.numUnions;
+      total.peakSummarySize = max(total.peakSummarySize, stats.peakSummarySize);
+      total.seconds += stats.seconds;
+      maxAnalyses = max(maxAnalyses, stats.numAnalyses);
+    }
+    // Slowest first
+    std::sort(funcs.begin(), funcs.end(), [](const auto& a, const auto& b) {
+      return (a.second->seconds != b.second->seconds) ? a.second->seconds > b.second->seconds
+        : a.first->getName() < b.first->getName();
+    });
+    vector<pair<const char*, uint64_t>> counters = {
+      {"functions_analyzed", numFuncs},
+      {"analyses", total.numAnalyses},
+      {"reanalyses", total.numAnalyses - numFuncs},
+      {"max_analyses_per_function", maxAnalyses},
+      {"inst_visits", total.numInstVisits},
+      {"set_unions", total.numUnions},
+      {"peak_summary_size", total.peakSummarySize},
+      {"analysis_ms", uint64_t(total.seconds * 1000)},
+      {"critical_path_ms", uint64_t(criticalPathSeconds * 1000)},
+    };
+
+    if (jsonFile != "") {
+      std::error_code err;
+      raw_fd_ostream os(jsonFile, err);
+      if (err) {
+        errs() << "Failed to open stats file '" << jsonFile << "': " << err.message() << "\n";
+      } else {
+        json::OStream J(os, 1);
+        J.object([&] {
+          J.attributeObject("timers", [&] {
+            for (int phase = 0; phase < NUM_PHASES; phase++) {
+              const TimeRecord& time = timers[phase].getTotalTime();
+              J.attributeObject(phaseNames[phase][0], [&] {
+                J.attribute("wall", time.getWallTime());
+                J.attribute("user", time.getUserTime());
+                J.attribute("sys", time.getSystemTime());
+              });
+            }
+          });
+          J.attributeObject("counters", [&] {
+            for (auto [name, value] : counters) {
+              J.attribute(name, int64_t(value));
+            }
+          });
+          J.attributeArray("functions", [&] {
+            for (auto [F, stats] : funcs) {
+              J.object([&] {
+                J.attribute("name", F->getName());
+                J.attribute("seconds", stats->seconds);
+                J.attribute("analyses", int64_t(stats->numAnalyses));
+                J.attribute("inst_visits", int64_t(stats->numInstVisits));
+                J.attribute("set_unions", int64_t(stats->numUnions));
+                J.attribute("peak_summary_size", int64_t(stats->peakSummarySize));
+              });
+            }
+          });
+        });
+        os << "\n";
+      }
+    }
+
+    if (print) {
+      raw_ostream& os = errs();
+      os << "===" << std::string(73, '-') << "===\n";
+      os << "                         Taint pass counters\n";
+      os << "===" << std::string(73, '-') << "===\n";
+      for (auto [name, value] : counters) {
+        os << format_decimal(value, 12) << "  " << name << "\n";
+      }
+      os << "\n  Slowest functions (seconds, analyses, instruction visits):\n";
+      for (size_t ix = 0; ix < funcs.size() && ix < 10; ix++) {
+        auto [F, stats] = funcs[ix];
+        os << format("%12.4f", stats->seconds) << format_decimal(stats->numAnalyses, 8)
+           << format_decimal(stats->numInstVisits, 12) << "  " << F->getName() << "\n";
+      }
+      os << "\n";
+      group.print(os, true);
+    }
+    // Or the group would print the timers again when destroyed
+    group.clear();
+  }
+};
+
+
+#define soft_check(e, ctx) if (!(e)) {outs() << "Failed: " << #e << ", " << ctx << "\n";}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static cl::opt<std::string> SourcesAndSinksFile("sources-and-sinks",
+                             cl::desc("File identifying sources and sinks"),
+                             cl::ValueRequired);
+
+static cl::opt<std::string> TaintCpFile("taint-copiers",
+                                        cl::desc("File identifying functions that copy taint from one entity to another"),
+                                        cl::ValueRequired);
+
+static cl::opt<std::string> SpecDbFile("spec-db",
+                             cl::desc("Spec database from compile_spec.py, instead of --sources-and-sinks and --taint-copiers"),
+                             cl::ValueRequired);
+
+static cl::opt<std::string> WrappersFile("wrappers",
+                             cl::desc("File identifying wrapper functions"),
+                             cl::ValueRequired);
+
+static cl::opt<unsigned> TaintThreads("taint-threads",
+                             cl::desc("Number of threads analyzing independent call-graph SCCs (0 = all cores)"),
+                             cl::init(1));
+
+static cl::opt<unsigned> WrapperDepth("wrapper-depth",
+                             cl::desc("Most calls to wrappers kept in the context of a source or sink (0 = no limit)"),
+                             cl::init(3));
+
+static cl::opt<bool> AutoWrappers("auto-wrappers",
+                             cl::desc("Also treat the functions that look like wrappers of sources and sinks as wrappers"));
+
+static cl::opt<std::string> WriteWrappersFile("write-wrappers",
+                             cl::desc("Write the wrapper functions (listed and detected) to this file, in the format of --wrappers"),
+                             cl::ValueRequired);
+
+static cl::opt<std::string> TuSummaryFile("tu-summary",
+                             cl::desc("Analyze one translation unit and write its summaries to this file, for merge_summaries.py"),
+                             cl::ValueRequired);
+
+static cl::opt<std::string> SummaryCacheDir("summary-cache",
+                             cl::desc("Directory in which function summaries are cached across runs"),
+                             cl::ValueRequired);
+
+static cl::opt<std::string> IncrementalFile("incremental",
+                             cl::desc("Reuse the summaries saved in this file by the previous run for the functions unaffected by changes, then save the new ones"),
+                             cl::ValueRequired);
+
+static cl::opt<std::string> CheckpointFile("checkpoint",
+                             cl::desc("Periodically save the state of the analysis to this file, for -resume"),
+                             cl::ValueRequired);
+
+static cl::opt<double> CheckpointInterval("checkpoint-interval",
+                             cl::desc("Seconds between the checkpoints of -checkpoint"),
+                             cl::init(600));
+
+static cl::opt<bool> Resume("resume",
+                             cl::desc("Resume the analysis from the -checkpoint file left by an interrupted run"));
+
+static cl::opt<double> FuncTimeBudget("func-time-budget",
+                             cl::desc("Seconds of analysis of a function before its summary is widened and frozen (0 = no limit)"),
+                             cl::init(0));
+
+static cl::opt<unsigned> FuncAnalysisBudget("func-analysis-budget",
+                             cl::desc("Analyses of a function before its summary is widened and frozen (0 = no limit)"),
+                             cl::init(0));
+
+static cl::opt<unsigned> SummarySizeBudget("summary-size-budget",
+                             cl::desc("Sources in a function's summary before it is widened and frozen (0 = no limit)"),
+                             cl::init(0));
+
+static cl::opt<double> TimeBudget("time-budget",
+                             cl::desc("Seconds of analysis before the summaries of the functions left are widened and frozen (0 = no limit)"),
+                             cl::init(0));
+
+static cl::opt<unsigned> MemoryBudget("memory-budget",
+                             cl::desc("MB of heap before the summaries of the functions left are widened and frozen (0 = no limit)"),
+                             cl::init(0));
+
+static cl::opt<bool> DemandDriven("demand-driven",
+                             cl::desc("Analyze only the functions that can be on a flow into a sink"));
+
+static cl::list<std::string> OnlySinks("only-sinks",
+                             cl::desc("Report only the flows into calls to these sinks, and analyze only the functions they depend on"),
+                             cl::CommaSeparated);
+
+static cl::opt<bool> ConnectFlows("connect-flows",
+                             cl::desc("Print only the flows, connected as by connect_flows.py"));
+
+static cl::opt<std::string> FlowsBaseDir("flows-base-dir",
+                             cl::desc("Base directory of the project, removed from filenames by -connect-flows"),
+                             cl::ValueRequired);
+
+enum OutputFormatKind { OUTPUT_TEXT, OUTPUT_JSON_LINES, OUTPUT_BINARY };
+
+static cl::opt<OutputFormatKind> OutputFormat("output-format",
+                             cl::desc("Output format"),
+                             cl::values(clEnumValN(OUTPUT_TEXT, "text", "Function summaries and flows (the default)"),
+                                        clEnumValN(OUTPUT_JSON_LINES, "jsonl", "JSON Lines, one record per flow"),
+                                        clEnumValN(OUTPUT_BINARY, "binary", "Binary, for read_flows.py")),
+                             cl::init(OUTPUT_TEXT));
+
+static cl::opt<std::string> OutputFile("output-file",
+                             cl::desc("File to write the output to, instead of stdout"),
+                             cl::ValueRequired);
+
+static cl::opt<bool> PrintTaintStats("taint-stats",
+                             cl::desc("Print the time of each phase of the pass and counters of the analysis to stderr"));
+
+static cl::opt<std::string> TaintStatsJsonFile("taint-stats-json",
+                             cl::desc("Write the phase times and the counters, also per function, as JSON to this file"),
+                             cl::ValueRequired);
+
+// Stops opt on a misconfigured run, with the exit code of cl's own errors;
+// report_fatal_error would abort with a crash dump.
+[[noreturn]] static void optionError(const Twine& message) {
+  errs() << "taint: " << message << "\n";
+  exit(1);
+}
+
+// Messages that would otherwise be mixed into the connected flows or the
+// JSON Lines.
+static raw_ostream& msgs() {
+  return (ConnectFlows || OutputFormat != OUTPUT_TEXT) ? errs() : outs();
+}
+
+#if USE_OLD_PASS_MANAGER
+class TaintPass : public llvm::ModulePass
+#else
+class TaintPass : public llvm::PassInfoMixin<TaintPass>
+#endif
+{
+public:
+  #if USE_OLD_PASS_MANAGER
+  static char ID;
+
+  TaintPass() : llvm::ModulePass(ID) { }
+  ~TaintPass(){ }
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+  }
+  #endif
+
+  SccWorkList funcWorkList;
+  DenseMap<Function*, set<Function*>> callersOfFunc;
+  PassStats passStats;
+
+  DenseMap<Function*, FuncSummary_t> funcFlowsBySink; // function summaries
+  set<Function*> taintCopiers;
+
+  map<Function*, vector<int>> sinksOfFunc;
+  map<Function*, vector<int>> sourcesOfFunc;
+  set<Function*> wrapperFuncs;
+  // -auto-wrappers: whether each candidate turned out to be a wrapper.  The
+  // entries are created before the analysis, and each is set right after
+  // the candidate is analyzed, before any of its callers are.
+  map<Function*, char> autoWrappers;
+
+  DenseMap<Function*, vector<int>> funcArgSrcCat;
+  DenseMap<Function*, vector<int>> funcArgSinkCat;
+  DenseMap<Function*, int> funcRetCat;
+  set<Function*> knownExtFuncs;
+  set<Function*> unknownExtFuncs;
+  StringSet<> queriedSinks; // -only-sinks
+  StringSet<> absentQueriedSinks; // sinks in the spec, but not in the module
+  set<Function*> connectedAuxSinks; // whose auxiliary sinks may be connected to the queried ones
+  set<CallBase*> connectedAuxCalls; // whose auxiliary sinks are, once analyzed
+
+  SummaryCache summaryCache;
+  vector<char> sccWroteGlobals; // per SCC; such SCCs are never cached
+  vector<char> sccFromCache;
+  vector<char> sccReused; // from the -incremental file
+  DenseMap<Function*, vector<GlobalVariable*>> gvarsUsedBy; // the inverse of fnsReferencingGvar
+
+  // -incremental: the summaries and global taint of the previous run, to
+  // find the functions whose inputs changed, and the globals each function
+  // may write in this run or in the previous one.
+  DenseMap<Function*, FuncSummary_t> savedSummaryOf;
+  DenseMap<GlobalVariable*, SensSrcSet_t> savedGlobalTaintOf;
+  DenseMap<Function*, set<GlobalVariable*>> gvarsWrittenBy;
+  DenseMap<Function*, vector<Function*>> calleesOf;
+  // -incremental: the SCCs that depend on each other through calls or
+  // globals, as groups of SCC indices, and the group of each SCC.
+  vector<vector<int>> sccGroups;
+  vector<int> groupOfScc;
+  set<Function*> promotedFuncs; // since the last checkIncremental()
+  set<GlobalVariable*> promotedGvars; // written by the functions promoted since then
+
+  // Resource budgets (-func-time-budget etc.).  The entries are created
+  // before the analysis, and each is only used by the thread analyzing its
+  // function.
+  struct FuncBudget {
+    unsigned numAnalyses = 0;
+    double seconds = 0;
+    const char* degradedBy = nullptr; // the budget exceeded, once degraded
+  };
+  bool budgetsEnabled = false;
+  DenseMap<Function*, FuncBudget> budgetOf;
+  std::chrono::steady_clock::time_point analysisStart;
+  std::atomic<const char*> globalBudgetExceeded{nullptr};
+
+  const SrcOrSink_t* storeScrink(SrcOrSink_t src) {
+    return &scrinkTable[scrinkTable.intern(src)];
+  }
+
+  // A scrink of a call to a wrapper stands for the scrink it wraps, which
+  // says which argument is the source or sink; the wrapper's own argument
+  // index is neither meaningful nor printed, so it is always 0.  The calls
+  // to wrappers form a call string, the most recent call outermost; with
+  // -wrapper-depth=K, only the K most recent calls are kept, so that nested
+  // wrappers don't multiply the scrinks without bound.  The interned
+  // scrinks memoize each context.
+  const SrcOrSink_t* wrapScrink(Function* wrapper, CallBase* callsite, const SrcOrSink_t& inner) {
+    SrcOrSink_t scrink = {wrapper, 0, callsite, inner.auxType, storeScrink(limitWrapperDepth(inner, WrapperDepth - 1))};
+    return storeScrink(scrink);
+  }
+
+  SrcOrSink_t limitWrapperDepth(const SrcOrSink_t& scrink, unsigned depth) {
+    if (WrapperDepth == 0 || scrink.wrapped == nullptr) {
+      return scrink;
+    }
+    if (depth == 0) {
+      const SrcOrSink_t* innermost = &scrink;
+      while (innermost->wrapped) {
+        innermost = innermost->wrapped;
+      }
+      return *innermost;
+    }
+    SrcOrSink_t limited = scrink;
+    limited.wrapped = storeScrink(limitWrapperDepth(*scrink.wrapped, depth - 1));
+    return limited;
+  }
+
+  // Wrappers are analyzed once per call, so a recursive wrapper would be
+  // analyzed in ever longer contexts; treat them as ordinary functions.
+  void demoteRecursiveWrappers(Module& M, map<Value*, set<Value*>>& depsOf) {
+    for (Function& F : M) {
+      if (wrapperFuncs.count(&F) == 0) {
+        continue;
+      }
+      Function* wrapper = &F;
+      set<Value*> seen;
+      vector<Value*> workList(depsOf[wrapper].begin(), depsOf[wrapper].end());
+      bool recursive = false;
+      while (!workList.empty() && !recursive) {
+        Value* node = workList.back();
+        workList.pop_back();
+        if (!isa<Function>(node) || !seen.insert(node).second) {
+          continue;
+        }
+        recursive = (node == wrapper);
+        workList.insert(workList.end(), depsOf[node].begin(), depsOf[node].end());
+      }
+      if (recursive) {
+        msgs() << "Not treating recursive function " << wrapper->getName() << " as a wrapper\n";
+        wrapperFuncs.erase(wrapper);
+      }
+    }
+  }
+
+  bool isWrapper(Function* func) {
+    if (wrapperFuncs.count(func)) {
+      return true;
+    }
+    auto it = autoWrappers.find(func);
+    return it != autoWrappers.end() && it->second;
+  }
+
+  bool isSourceOrSinkFunc(Function* callee) {
+    if (funcRetCat.lookup(callee) != AUX_TYPE_NULL) {
+      return true;
+    }
+    for (auto* cats : {&funcArgSrcCat, &funcArgSinkCat}) {
+      auto it = cats->find(callee);
+      if (it != cats->end()) {
+        for (int cat : it->second) {
+          if (cat != AUX_TYPE_NULL) {
+            return true;
+          }
+        }
+      }
+    }
+    return false;
+  }
+
+  // Candidates for -auto-wrappers: small functions that call sources or
+  // sinks and no other defined (or unknown) function, and whose taint
+  // depends on no other function, even through globals; so their summary
+  // is final after they are first analyzed.
+  void findWrapperCandidates(const vector<Function*>& definedFuncs, map<Value*, set<Value*>>& depsOf) {
+    set<Function*> globalWriters;
+    for (auto const& [node, deps] : depsOf) {
+      if (isa<GlobalVariable>(node)) {
+        for (Value* writer : deps) {
+          globalWriters.insert(cast<Function>(writer));
+        }
+      }
+    }
+    for (Function* F : definedFuncs) {
+      if (wrapperFuncs.count(F) || globalWriters.count(F) || F->getInstructionCount() > AUTO_WRAPPER_MAX_INSTS) {
+        continue;
+      }
+      bool isCandidate = true;
+      for (Value* dep : depsOf[F]) {
+        if (isa<Function>(dep) || !depsOf[dep].empty()) {
+          isCandidate = false;
+        }
+      }
+      bool callsSourceOrSink = false;
+      for (auto &B : *F) {
+        for (auto &I : B) {
+          CallBase* callsite = dyn_cast<CallBase>(&I);
+          if (!callsite) {
+            continue;
+          }
+          Function* callee = callsite->getCalledFunction();
+          if (!callee || !callee->isDeclaration() || unknownExtFuncs.count(callee)) {
+            isCandidate = false;
+          } else if (isSourceOrSinkFunc(callee)) {
+            callsSourceOrSink = true;
+          }
+        }
+      }
+      if (isCandidate && callsSourceOrSink) {
+        autoWrappers[F] = false;
+      }
+    }
+  }
+
+  // A candidate is a wrapper if its summary connects its parameters to a
+  // sink it calls, or a source it calls to its return value or arguments.
+  void detectWrapper(Function& F) {
+    auto it = autoWrappers.find(&F);
+    if (it == autoWrappers.end()) {
+      return;
+    }
+    for (auto const& [sink, sources] : funcFlowsBySink.find(&F)->second) {
+      for (const SensSrc_t& src : sources) {
+        if (sink.callsite == nullptr ? (src.callsite != nullptr && !src.isPlaceholder())
+                                     : (src.isSummaryScrink() && !sink.isPlaceholder())) {
+          it->second = true;
+          return;
+        }
+      }
+    }
+  }
+
+  void writeWrappers(Module& M) {
+    std::error_code err;
+    raw_fd_ostream os(WriteWrappersFile, err);
+    if (err) {
+      errs() << "Failed to open wrappers file '" << WriteWrappersFile << "': " << err.message() << "\n";
+      return;
+    }
+    for (Function& F : M) {
+      if (isWrapper(&F)) {
+        os << F.getName() << "\n";
+      }
+    }
+  }
+
+  // The standard streams passed as the FILE* arguments of the call.
+  vector<string> stdFilesOf(const SrcOrSink_t &src) {
+    vector<string> files;
+    vector<int>& argCats = funcArgSinkCat[src.func];
+    for (int ixArg=0; ixArg < argCats.size(); ixArg++) {
+      if (argCats[ixArg] != AUX_TYPE_FILE) {
+        continue;
+      }
+      Value* arg = src.callsite->getArgOperand(ixArg);
+      //dump(arg);
+      llvm::LoadInst* load = dyn_cast<LoadInst>(arg);
+      if (load && dyn_cast<GlobalValue>(load->getPointerOperand())) {
+        vector<string> std_files = {"stdin", "stdout", "stderr"};
+        for (string sf : std_files) {
+          if (load->getPointerOperand()->getName() == sf) {
+            //load->getPointerOperand()->dump();
+            files.push_back(sf);
+          }
+        }
+      }
+      //outs() << arg;
+    }
+    return files;
+  }
+
+  void dumpSrcOrSink(llvm::raw_ostream &os, const SrcOrSink_t &src, string* wrapperIndent) {
+    string funcName;
+    if (src.auxConst) {
+      string auxString = getStringFromConstantExpr(src.auxConst);
+      os << "{\"aux_file\":";
+      os << "\"" << auxString << "\"}";
+      return;
+    }
+    os << "{\"Func\":";
+    if (src.func) {
+      funcName = src.func->getName();
+      os << "\"" << funcName << "\"";
+    } else {
+      os << "\"null\"";
+    }
+
+    os << ", \"aux\":\"" << getAuxName(src.auxType) << "\"";
+
+    bool is_wrapped = (src.wrapped && wrapperIndent != nullptr);
+
+    if (!is_wrapped) {
+      os << ", \"arg\":" << src.ixArg;
+    }
+    //if (src.auxConst) {
+    //  os << ", \"filename\":" << src.ixArg;
+    //}
+    os << ", \"callsite\": ";
+    if (src.callsite) {
+      write_file_line_col(src.callsite, os);
+      for (const string& sf : stdFilesOf(src)) {
+        os << ", \"FILE*\":\"" << sf << "\"";
+      }
+
+      //src.callsite->print(os);
+    } else {
+      os << "null";
+    }
+
+    if (is_wrapped) {
+      os << ", \"wrapped\": \n" << *wrapperIndent;
       dumpSrcOrSink(os, *src.wrapped, nullptr);
       //os << "";
     }
 
-    os << "}";
+    os << "}";
+  }
+
+
+  std::pair<std::string, std::vector<std::string>>
+  parse_arg_string(std::string s)
+  {
+    size_t pos, base;
+    std::string split{" -> "};
+    std::string argname, flow;
+    std::vector<std::string> argv{};
+    std::pair<std::string, std::vector<std::string>> pair{};
+
+    // split arg name and flow info
+    if ((pos = s.find(split)) == std::string::npos)
+    {
+      std::cerr << s << " formatted incorrectly" << std::endl;
+      return pair;
+    }
+    argname = s.substr(0, pos);
+    // std::cout << "\tfirst:  " << argname << std::endl;
+    base = pos+split.length();
+    flow = s.substr(base, s.length());
+    // std::cout << "\tsecond: " << flow << std::endl;
+
+    // is flow info formatted correctly
+    if (flow.find("[ ") == std::string::npos || flow.find(" ]") == std::string::npos)
+    {
+      std::cerr << flow << " formatted incorrectly" << std::endl;
+      return pair;
+    }
+
+    // parse arg taint flows
+    argv.push_back(argname);
+    if (flow.size() > 3) // only other option (via. if statements above) is flow.size == 3
+    {
+      flow = flow.substr(2, flow.length()-4); // cut out whitespace and '[', ']'
+      // std::cout << "\tnew flow: |" << flow << "|" << std::endl;
+      split = " , ";
+      while ((pos = flow.find(split)) != std::string::npos)
+      {
+        std::string s = flow.substr(0, pos);
+        // std::cout << "\t\tfind: " << s << std::endl;
+        argv.push_back(s);
+        flow.erase(0, pos + split.length());
+      }
+      // std::cout << "\t\tfind: " << flow << std::endl; // last rhs of " , "
+      argv.push_back(flow);
+    }
+    pair = std::make_pair(argname, argv);
+    // std::cout << "\tpair: " << std::get<0>(pair) << " | [";
+    // for (auto& item : std::get<1>(pair))
+    //   std::cout << item << ",";
+    // std::cout << "]" << std::endl;
+
+    return pair;
+  }
+
+  std::map<std::string, std::vector<std::pair<std::string, std::vector<std::string>>>> parse_taint_cp_file() {
+    // below data structure: {'libcfn': [('argname', ['taint_flows_to_argname',...?]),...]}
+    std::map<std::string, std::vector<std::pair<std::string, std::vector<std::string>>>> fnprototype_map;
+    std::string   line;
+    std::ifstream file{TaintCpFile};
+
+    if (!file.is_open())
+    {
+      std::cerr << "Failed to open file " << TaintCpFile << std::endl;
+      return fnprototype_map;
+    }
+
+    // read file line by line
+    while (std::getline(file, line))
+    {
+      size_t pos, lpos, rpos;
+      std::string fnname, args;
+      std::vector<std::pair<std::string, std::vector<std::string>>> arg_list{};
+
+      // std::cout << "Line: " << line << std::endl;
+      // get fnname
+      if ((pos = line.find(" ")) == std::string::npos ||
+          (lpos = line.find("(")) == std::string::npos ||
+          (rpos = line.find(")")) == std::string::npos)
+      {
+        std::cerr << TaintCpFile << " formatted incorrectly. Not parsing file" << std::endl;
+        return fnprototype_map;
+      }
+      fnname = line.substr(0, pos);
+      // std::cout << fnname << std::endl;
+      args   = line.substr(lpos+2, rpos-lpos-3);
+      // std::cout << args << "| " << args.size() << std::endl;
+
+      fnprototype_map[fnname] = arg_list;
+
+      std::string delim{" ]"};
+      while ((pos = args.find(delim)) != std::string::npos)
+      {
+        std::string s = args.substr(0, pos+2);
+        if (s[0] == ',')
+          s.erase(0, 2);
+        // std::cout << "find: " << s << std::endl;
+        fnprototype_map[fnname].push_back(parse_arg_string(s));
+        args.erase(0, pos + delim.length());
+      } // should be no string left
+    }
+    file.close();
+    return fnprototype_map;
+  }
+
+  // The module's intrinsics, sorted by name, to find the first one (in
+  // module order) whose name has a given prefix without scanning the whole
+  // module for every taint copier.
+  struct IntrinsicIndex {
+    vector<pair<StringRef, size_t>> byName; // name, position in the module
+    vector<Function*> funcs;
+
+    explicit IntrinsicIndex(Module &M) {
+      for (Function& fn : M) {
+        if (fn.getName().startswith("llvm.")) {
+          byName.push_back({fn.getName(), funcs.size()});
+          funcs.push_back(&fn);
+        }
+      }
+      std::sort(byName.begin(), byName.end());
+    }
+
+    Function* findByPrefix(StringRef prefix) const {
+      auto it = std::lower_bound(byName.begin(), byName.end(), pair<StringRef, size_t>{prefix, 0});
+      size_t first = SIZE_MAX;
+      for (; it != byName.end() && it->first.startswith(prefix); ++it) {
+        first = min(first, it->second);
+      }
+      return (first == SIZE_MAX) ? nullptr : funcs[first];
+    }
+  };
+
+  void parse_taint_copiers(Module &M) {
+    std::map<std::string, std::vector<std::pair<std::string, std::vector<std::string>>>> fnprototype_map;
+    fnprototype_map = parse_taint_cp_file();
+    IntrinsicIndex intrinsics(M);
+
+    // std::cout << "\n\nModule fns:" << std::endl;
+    // for (const llvm::Function& fn : M.getFunctionList())
+    //   std::cout << "Fn: " << fn.getName().data() << std::endl;
+
+    for (auto const& x : fnprototype_map)
+    {
+      std::string libcfn = x.first;
+      std::vector<std::pair<std::string, std::vector<std::string>>> val = x.second;
+      Function* libc_fnptr;
+      int idx;
+      std::map<std::string, int> argidx_map; // argument name to idx
+
+      argidx_map["return"] = RETVAL_CODE;
+
+      if (!(libc_fnptr = M.getFunction(libcfn)))
+      {
+        // handle llvm intrinsic functions like memcpy
+        // llvm.memcpy.p0i8.p0i8.i64 for memcpy (.p0i8.p0i8.i64 might not be per architecture, [.p0i8.p0i8.i32?]) so only use initial 'llvm.'+name
+        if (!(libc_fnptr = intrinsics.findByPrefix("llvm." + libcfn)))
+          continue;
+      }
+      knownExtFuncs.insert(libc_fnptr);
+      taintCopiers.insert(libc_fnptr);
+
+      // index arguments first because we refer 'back' at them. otherwise, this would cause an error:
+      // fn ( arg1 -> [ arg2 ], arg2 -> [] )
+      idx = 0;
+      for (std::pair<std::string, std::vector<std::string>>& p : val)
+      {
+        argidx_map[std::get<0>(p)] = idx++;
+      }
+
+      idx = 0;
+      for (std::pair<std::string, std::vector<std::string>>& p : val)
+      {
+        std::string argname;
+        Sink_t arg_sink;
+
+        argname = std::get<0>(p);
+        // std::cout << "\t" << argname << ": [";
+        arg_sink = {libc_fnptr, idx++, nullptr};
+        // arg_sink = {libc_fnptr, idx, nullptr};
+        // argidx_map[argname] = idx++;
+        for (std::string flowname : std::get<1>(p))
+        {
+          SensSrc_t arg_src;
+          arg_src = {libc_fnptr, argidx_map[flowname], nullptr};
+          funcFlowsBySink[libc_fnptr].sourcesOf(arg_src).insert(arg_sink);
+          // funcFlowsBySink[libc_fnptr][arg_sink].insert(arg_src);
+          // make argsrc w/ index from argidx_map
+          // std::cout << flowname << ",";
+        }
+        // std::cout << "]\n";
+      }
+
+      // printFuncSummary(*libc_fnptr);
+    }
+    // std::cout << std::endl;
+  }
+
+
+  void populate_sources_and_sinks_2(Module &M) {
+    std::string filename = SourcesAndSinksFile;
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+      std::cerr << "Failed to open file " << filename << std::endl;
+      return;
+    }
+
+    vector<string> foundFuncs;
+    vector<string> missingFuncs;
+
+    std::string line;
+    while (std::getline(file, line)) {
+      // Most functions in a large file aren't in the module; look the name
+      // up before tokenizing the rest of the line.
+      StringRef name = getToken(line).first;
+      Function* func = M.getFunction(name);
+      if (!func) {
+        missingFuncs.push_back(name.str());
+        if (queriedSinks.count(name)) {
+          std::istringstream iss(line);
+          string token;
+          iss >> token;
+          while (iss >> token && token != "->") {
+            if (StringRef(token).endswith("Sink")) {
+              absentQueriedSinks.insert(name);
+            }
+          }
+        }
+        continue;
+      }
+      std::istringstream iss(line);
+      std::string type, funcName;
+
+      // Read the function name
+      iss >> funcName;
+
+      knownExtFuncs.insert(func);
+      foundFuncs.push_back(funcName);
+
+      funcArgSrcCat[func].resize(func->arg_size());
+      // Variadic functions get 1 more sink type for their variadic args
+      funcArgSinkCat[func].resize(func->arg_size() + (func->isVarArg() ? 1 : 0));
+
+      // Read all arguments for this function
+      std::string curcat;
+      ssize_t ixArg = -1;
+      while (iss >> curcat) {
+        ixArg++;
+        bool isRet = false;
+        if (curcat == "-"s) {
+          continue;
+        } else if (curcat == "->"s) {
+          iss >> curcat;
+          isRet = true;
+        } else if ((size_t)ixArg >= func->arg_size() && !func->isVarArg()) {
+          msgs() << "Error: " << funcName << ": too many arguments!\n";
+          continue;
+        }
+
+        int taint_cat = AUX_TYPE_MAIN;
+        bool isSrc = false;
+        bool isSink = false;
+        if (curcat.substr(0,4) == "File"s) {
+          curcat = curcat.substr(4, curcat.size());
+          taint_cat = AUX_TYPE_FILE;
+        }
+        if (curcat == "Src"s) {
+          isSrc = true;
+        } else if (curcat == "Sink"s) {
+          isSink = true;
+        } else if (curcat == "SrcAndSink"s) {
+          isSrc = true;
+          isSink = true;
+        } else if (curcat == "none"s) {
+          // do nothing in this case
+        } else {
+          msgs() << "Error: unrecognized catcode '" << curcat << "', function " << funcName << "\n";
+        }
+        if (isRet) {
+          if (isSrc) {
+            funcRetCat[func] = taint_cat;
+          }
+          if (isSink) {
+            msgs() << "Error: " << funcName << ": return value cannot be a sink!\n";
+          }
+        } else {
+          if (isSrc) {
+            funcArgSrcCat[func][ixArg] = taint_cat;
+            // llvm::outs() << "Reading src: " << llvm::demangle(func->getName().data()) << " (" << func->getName() << ")\n";
+          }
+          if (isSink) {
+            funcArgSinkCat[func][ixArg] = taint_cat;
+            // llvm::outs() << "Reading sink: " << llvm::demangle(func->getName().data()) << " (" << func->getName() << ")\n";
+          }
+        }
+
+      }
+
+    }
+    msgs() << "Found " << foundFuncs.size() << " source/sink functions in program; " << missingFuncs.size() << " are absent.\n";
+
+    file.close();
+  }
+
+  // As populate_sources_and_sinks_2 and parse_taint_copiers, from a spec
+  // database: only the module's functions are looked up.
+  void populate_from_spec_db(Module &M, const SpecDb& specDb) {
+    size_t numFound = 0;
+    for (Function& F : M) {
+      Function* func = &F;
+      vector<SpecDb::Record> records = specDb.specsOf(func->getName());
+      if (records.empty()) {
+        continue;
+      }
+      knownExtFuncs.insert(func);
+      numFound += records.size();
+      for (const SpecDb::Record& record : records) {
+        funcArgSrcCat[func].resize(func->arg_size());
+        // Variadic functions get 1 more sink type for their variadic args
+        funcArgSinkCat[func].resize(func->arg_size() + (func->isVarArg() ? 1 : 0));
+        for (size_t ixArg = 0; ixArg < record.argCats.size(); ixArg++) {
+          uint8_t cat = record.argCats[ixArg];
+          if (cat == 0) {
+            continue;
+          }
+          if (ixArg >= func->arg_size() && !func->isVarArg()) {
+            msgs() << "Error: " << func->getName() << ": too many arguments!\n";
+            continue;
+          }
+          int taint_cat = (cat & SPEC_CAT_FILE) ? AUX_TYPE_FILE : AUX_TYPE_MAIN;
+          if ((cat & SPEC_CAT_SRC) && ixArg < funcArgSrcCat[func].size()) {
+            funcArgSrcCat[func][ixArg] = taint_cat;
+          }
+          if ((cat & SPEC_CAT_SINK) && ixArg < funcArgSinkCat[func].size()) {
+            funcArgSinkCat[func][ixArg] = taint_cat;
+          }
+        }
+        if (record.retCat & SPEC_CAT_SRC) {
+          funcRetCat[func] = (record.retCat & SPEC_CAT_FILE) ? AUX_TYPE_FILE : AUX_TYPE_MAIN;
+        }
+      }
+    }
+    msgs() << "Found " << numFound << " source/sink functions in program; " << (specDb.numSpecLines - numFound) << " are absent.\n";
+
+    // A copier applies to the function of its name or else, for intrinsics
+    // like memcpy, to the first (in module order) named "llvm." + its name + ...
+    vector<Function*> exactOf(specDb.numCopiers(), nullptr);
+    vector<Function*> intrinsicOf(specDb.numCopiers(), nullptr);
+    for (Function& F : M) {
+      StringRef name = F.getName();
+      uint32_t ix = specDb.findCopier(name);
+      if (ix != SPEC_DB_NONE) {
+        exactOf[ix] = &F;
+      }
+      if (!name.consume_front("llvm.")) {
+        continue;
+      }
+      for (size_t len = 0; len <= name.size(); len++) {
+        ix = specDb.findCopier(name.take_front(len));
+        if (ix != SPEC_DB_NONE && !intrinsicOf[ix]) {
+          intrinsicOf[ix] = &F;
+        }
+      }
+    }
+    for (uint32_t ix = 0; ix < specDb.numCopiers(); ix++) {
+      Function* libc_fnptr = exactOf[ix] ? exactOf[ix] : intrinsicOf[ix];
+      if (!libc_fnptr) {
+        continue;
+      }
+      knownExtFuncs.insert(libc_fnptr);
+      taintCopiers.insert(libc_fnptr);
+      for (auto [ixSink, ixSrc] : specDb.copierEdges(ix)) {
+        funcFlowsBySink[libc_fnptr].sourcesOf({libc_fnptr, ixSink, nullptr}).insert({libc_fnptr, ixSrc, nullptr});
+      }
+    }
+  }
+
+  // Reads the sources, sinks, wrappers and taint copiers; exits through
+  // optionError if the spec options are missing, conflict, or name an
+  // unusable spec database.
+  void loadSpecs(Module &M) {
+    if (SpecDbFile == "") {
+      if (SourcesAndSinksFile == "" || TaintCpFile == "") {
+        optionError("either --spec-db or both --sources-and-sinks and --taint-copiers are required");
+      }
+      //populate_sources_and_sinks_1(M);
+      populate_sources_and_sinks_2(M);
+      populate_wrappers(M);
+      parse_taint_copiers(M);
+      return;
+    }
+    if (SourcesAndSinksFile != "" || TaintCpFile != "") {
+      optionError("--spec-db replaces --sources-and-sinks and --taint-copiers; pass only one of them");
+    }
+    SpecDb specDb;
+    string error;
+    if (!specDb.open(SpecDbFile, error)) {
+      optionError(error);
+    }
+    populate_from_spec_db(M, specDb);
+    populate_wrappers(M);
+    for (auto const& entry : queriedSinks) {
+      if (M.getFunction(entry.getKey())) {
+        continue;
+      }
+      for (const SpecDb::Record& record : specDb.specsOf(entry.getKey())) {
+        if (any_of(record.argCats, [](uint8_t cat) { return cat & SPEC_CAT_SINK; })) {
+          absentQueriedSinks.insert(entry.getKey());
+        }
+      }
+    }
   }
 
+  void populate_wrappers(Module &M) {
+    std::string filename = WrappersFile; //"/host_dmc/gpt/wrappers.txt";
+    if (WrappersFile == "") {
+      errs() << "No wrappers file specified.\n";
+      return;
+    }
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+      errs() << "Failed to open wrappers file '" << filename << "'\n";
+      return;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+      std::istringstream iss(line);
+      std::string funcName;
+      iss >> funcName;
+      Function* func = M.getFunction(funcName);
+      if (!func) {
+        msgs() << "Failed to find wrapper function " << funcName << "\n";
+      } else {
+        wrapperFuncs.insert(func);
+      }
+    }
+    file.close();
+  }
 
-  std::pair<std::string, std::vector<std::string>>
-  parse_arg_string(std::string s)
-  {
-    size_t pos, base;
-    std::string split{" -> "};
-    std::string argname, flow;
-    std::vector<std::string> argv{};
-    std::pair<std::string, std::vector<std::string>> pair{};
 
-    // split arg name and flow info
-    if ((pos = s.find(split)) == std::string::npos)
-    {
-      std::cerr << s << " formatted incorrectly" << std::endl;
-      return pair;
+  void plugInSummary(CallBase* callsite, TaintMapType& taintOfVal) {
+    llvm::Function* callee = callsite->getCalledFunction();
+    llvm::Function* caller = callsite->getFunction();
+    if (!callee) {return;}
+    FuncSummary_t& callerSummary = funcFlowsBySink.find(caller)->second;
+    // A recursive call adds to the very summary it reads, which would move
+    // the entries being iterated over; iterate over a snapshot instead.
+    FuncSummary_t calleeSummarySnapshot;
+    if (callee == caller) {
+      calleeSummarySnapshot = callerSummary;
     }
-    argname = s.substr(0, pos);
-    // std::cout << "\tfirst:  " << argname << std::endl;
-    base = pos+split.length();
-    flow = s.substr(base, s.length());
-    // std::cout << "\tsecond: " << flow << std::endl;
+    const FuncSummary_t& calleeSummary = (callee == caller) ? calleeSummarySnapshot : funcFlowsBySink.find(callee)->second;
+    for (auto const& [sumSink, sumSources] : calleeSummary) {
+      Value* valToTaint = nullptr;
+      SensSrcSet_t* pTaintDest;
+      if (sumSink.callsite == nullptr) {
+        assert(sumSink.func == callee);
+        if (sumSink.ixArg == RETVAL_CODE) {
+          valToTaint = callsite;
+        } else {
+          valToTaint = callsite->getArgOperand(sumSink.ixArg);
+        }
+        pTaintDest = nullptr; //&taintOfVal[valToTaint];
+      } else {
+        if (isWrapper(callee)) {
+          pTaintDest = &callerSummary.sourcesOf(*wrapScrink(callee, callsite, sumSink));
+        } else {
+          pTaintDest = &callerSummary.sourcesOf(sumSink);
+        }
+      }
+      for (const SensSrc_t& sumSrc : sumSources) {
+        //errs() << "sumSrc = ";
+        //dumpSrcOrSink(errs(), sumSrc, nullptr);
+        //errs() << "\n";
+        if (!sumSrc.isSummaryScrink()) {
+          if (sumSink.callsite != nullptr && !sumSink.isPlaceholder() && !sumSrc.isPlaceholder()) {
+            // Do nothing; no need to propagate fully concrete flows upwards.
+            // (Flows into or out of a call to another TU are only known once
+            // the TUs are merged, in the context of each caller.)
+          } else {
+            SensSrc_t insSrc;
+            if (isWrapper(callee)) {
+              insSrc = *wrapScrink(callee, callsite, sumSrc);
+            } else {
+              insSrc = sumSrc;
+            }
+            if (pTaintDest) {
+              callerSummary.noteGrowth(pTaintDest->insert(insSrc));
+            } else {
+              taintOfVal.addTaint(valToTaint, insSrc);
+            }
+          }
+        } else {
+          assert(sumSrc.func == callee);
+          assert(sumSrc.ixArg != RETVAL_CODE) ;
+          Value* actArg = callsite->getArgOperand(sumSrc.ixArg);
+          if (pTaintDest) {
+            callerSummary.noteGrowth(taintOfVal.unionTaintInto(*pTaintDest, actArg));
+          } else {
+            taintOfVal.addTaintFrom(valToTaint, actArg);
+          }
+        }
+      }
+    }
+  }
 
-    // is flow info formatted correctly
-    if (flow.find("[ ") == std::string::npos || flow.find(" ]") == std::string::npos)
-    {
-      std::cerr << flow << " formatted incorrectly" << std::endl;
-      return pair;
+  // When analyzing a single TU, a call to an unknown external function may
+  // be a call to a function defined in another TU.  Each argument of such a
+  // call becomes a placeholder sink, and its return value and arguments are
+  // tainted with placeholder sources; merge_summaries.py later connects them
+  // through the callee's summary.
+  void addExternCallPlaceholders(CallBase* callsite, Function* func, TaintMapType& taintOfVal) {
+    Function* callee = callsite->getCalledFunction();
+    FuncSummary_t& summary = funcFlowsBySink.find(func)->second;
+    for (int arg = 0; arg < (ssize_t) callsite->arg_size(); arg++) {
+      Sink_t sink = {callee, arg, callsite, AUX_TYPE_EXT_IN};
+      summary.noteGrowth(taintOfVal.unionTaintInto(summary.sourcesOf(sink), callsite->getArgOperand(arg)));
+    }
+    for (int arg = RETVAL_CODE; arg < (ssize_t) callsite->arg_size(); arg++) {
+      SensSrc_t src = {callee, arg, callsite, AUX_TYPE_EXT_OUT};
+      if (arg == RETVAL_CODE) {
+        if (!callsite->getType()->isVoidTy()) {
+          taintOfVal.addTaint(callsite, src);
+        }
+      } else {
+        taintOfVal.addTaint(callsite->getArgOperand(arg), src);
+      }
+    }
+  }
+
+  set<Function*> findCallers(Function *callee) {
+    set<Function*> hit;
+    for (auto *U : callee->users()) {
+      if (auto *callInst = dyn_cast<CallInst>(U)) {
+        Function *caller = callInst->getFunction();
+        hit.insert(caller); // sets do not contain duplicates
+      }
+    }
+    return hit;
+  }
+
+  // With -only-sinks, whether the flows into the arguments of type auxType
+  // of the calls to callee may be reported: those of the queried sinks, and
+  // unless onlyQueried, the auxiliary sinks that may be connected to them
+  // (see findConnectedAuxCalls()).
+  bool isQueriedSinkOf(Function* callee, int auxType, bool onlyQueried) {
+    if (OnlySinks.empty() || queriedSinks.count(callee->getName())) {
+      return true;
+    }
+    return !onlyQueried && auxType != AUX_TYPE_MAIN && connectedAuxSinks.count(callee);
+  }
+
+  // Whether a sink is in a call to a queried sink, maybe through wrappers.
+  bool isInQueriedCall(const Sink_t& sink) {
+    for (const SrcOrSink_t* s = &sink; s != nullptr; s = s->wrapped) {
+      if (s->func && queriedSinks.count(s->func->getName())) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // The call of a scrink, below the calls to wrappers.
+  static CallBase* innermostCall(const SrcOrSink_t& scrink) {
+    const SrcOrSink_t* innermost = &scrink;
+    while (innermost->wrapped) {
+      innermost = innermost->wrapped;
+    }
+    return innermost->callsite;
+  }
+
+  // With -only-sinks, whether a sink is one of those queried, or one of the
+  // auxiliary sinks (e.g., the file name of an fopen) whose flows are
+  // connected to the flows into the queried sinks.
+  bool isQueriedSink(const Sink_t& sink) {
+    if (OnlySinks.empty() || sink.isPlaceholder() || isInQueriedCall(sink)) {
+      return true;
+    }
+    return sink.auxType != AUX_TYPE_MAIN && connectedAuxCalls.count(innermostCall(sink));
+  }
+
+  // With -only-sinks, the auxiliary flows connected to the flows into the
+  // queried sinks are those into their FILE* arguments, which come from the
+  // calls that return a FILE*, and so the flows into the auxiliary sinks of
+  // those calls (e.g., the file name of an fopen).
+  void findConnectedAuxSinks(Module& M) {
+    bool queriesFiles = false;
+    for (auto const& entry : queriedSinks) {
+      Function* F = M.getFunction(entry.getKey());
+      if (F && F->isDeclaration() && is_contained(funcArgSinkCat.find(F)->second, AUX_TYPE_FILE)) {
+        queriesFiles = true;
+      }
+    }
+    if (!queriesFiles) {
+      return;
+    }
+    for (Function& F : M) {
+      if (F.isDeclaration() && (funcRetCat.find(&F)->second == AUX_TYPE_FILE ||
+                                is_contained(funcArgSrcCat.find(&F)->second, AUX_TYPE_FILE))) {
+        connectedAuxSinks.insert(&F);
+      }
+    }
+  }
+
+  // With -only-sinks, once the analysis is done, finds the calls returning a
+  // FILE* that flows into a queried call, directly or through the auxiliary
+  // sinks of another such call (e.g., an fdopen of what an open returned).
+  void findConnectedAuxCalls(Module& M) {
+    if (connectedAuxSinks.empty()) {
+      return;
+    }
+    DenseMap<CallBase*, vector<CallBase*>> fileSrcCallsOf; // by the call of an auxiliary sink
+    vector<CallBase*> workList;
+    for (Function& F : M) {
+      for (auto const& [sink, sources] : funcFlowsBySink.find(&F)->second) {
+        if (sink.callsite == nullptr || sink.auxType != AUX_TYPE_FILE || sink.isPlaceholder()) {
+          continue;
+        }
+        for (const SensSrc_t& src : sources) {
+          if (src.callsite == nullptr || src.auxType != AUX_TYPE_FILE || src.isPlaceholder()) {
+            continue;
+          }
+          if (isInQueriedCall(sink)) {
+            if (connectedAuxCalls.insert(innermostCall(src)).second) {
+              workList.push_back(innermostCall(src));
+            }
+          } else {
+            fileSrcCallsOf[innermostCall(sink)].push_back(innermostCall(src));
+          }
+        }
+      }
+    }
+    while (!workList.empty()) {
+      CallBase* call = workList.back();
+      workList.pop_back();
+      for (CallBase* srcCall : fileSrcCallsOf.lookup(call)) {
+        if (connectedAuxCalls.insert(srcCall).second) {
+          workList.push_back(srcCall);
+        }
+      }
+    }
+  }
+
+  // Fails on the -only-sinks names that are not sinks in the spec, and warns
+  // about those that are not called in the module.
+  void checkQueriedSinks(Module& M) {
+    for (const string& name : OnlySinks) {
+      Function* F = M.getFunction(name);
+      if (F && F->isDeclaration() && any_of(funcArgSinkCat.find(F)->second, [](int cat) { return cat != AUX_TYPE_NULL; })) {
+        continue;
+      }
+      if (!F && absentQueriedSinks.count(name)) {
+        errs() << "-only-sinks: '" << name << "' is not called in the module; no flows into it will be found\n";
+        continue;
+      }
+      optionError("-only-sinks: '" + name + "' is not a sink in the sources and sinks spec");
+    }
+  }
+
+  // Whether F calls a sink (with -only-sinks, see isQueriedSinkOf()).
+  bool callsSink(Function* F, bool onlyQueried) {
+    for (auto &B : *F) {
+      for (auto &I : B) {
+        CallBase* callsite = dyn_cast<CallBase>(&I);
+        Function* callee = callsite ? callsite->getCalledFunction() : nullptr;
+        if (callee == nullptr || !callee->isDeclaration()) {
+          continue;
+        }
+        for (int cat : funcArgSinkCat.find(callee)->second) {
+          if (cat != AUX_TYPE_NULL && isQueriedSinkOf(callee, cat, onlyQueried)) {
+            return true;
+          }
+        }
+      }
+    }
+    return false;
+  }
+
+  static void addCallers(Function* callee, const function<void(Function*)>& add) {
+    for (auto *U : callee->users()) {
+      if (auto *callsite = dyn_cast<CallBase>(U)) {
+        add(callsite->getFunction());
+      }
+    }
+  }
+
+  // For -demand-driven and -only-sinks: the nodes of the dependency graph
+  // that can affect a reported flow.  A flow is found in a function that
+  // calls a (queried) sink, directly or through the sinks in its callees'
+  // summaries, so those functions and everything they depend on are needed.
+  // So are the callers of the needed functions that reach any sink (with
+  // -only-sinks, a queried sink or an auxiliary sink connected to them),
+  // whose flows into auxiliary sinks are connected to the reported flows.
+  set<Value*> findNodesOnSinkFlows(const vector<Function*>& definedFuncs, map<Value*, set<Value*>>& depsOf) {
+    set<Function*> reachesSink;
+    vector<Function*> funcWorkList;
+    auto reach = [&](Function* F) {
+      if (reachesSink.insert(F).second) {
+        funcWorkList.push_back(F);
+      }
+    };
+    for (Function* F : definedFuncs) {
+      if (callsSink(F, false)) {
+        reach(F);
+      }
+    }
+    while (!funcWorkList.empty()) {
+      Function* callee = funcWorkList.back();
+      funcWorkList.pop_back();
+      addCallers(callee, reach);
+    }
+
+    set<Value*> needed;
+    vector<Value*> workList;
+    auto need = [&](Value* node) {
+      if (needed.insert(node).second) {
+        workList.push_back(node);
+      }
+    };
+    for (Function* F : definedFuncs) {
+      if (callsSink(F, true)) {
+        need(F);
+      }
+    }
+    while (!workList.empty()) {
+      Value* node = workList.back();
+      workList.pop_back();
+      for (Value* dep : depsOf[node]) {
+        need(dep);
+      }
+      if (Function* F = dyn_cast<Function>(node); F && reachesSink.count(F)) {
+        addCallers(F, need);
+      }
+      // depsOf only has the callees of call instructions.
+      if (Function* F = dyn_cast<Function>(node)) {
+        for (auto &B : *F) {
+          for (auto &I : B) {
+            CallBase* callsite = dyn_cast<CallBase>(&I);
+            Function* callee = callsite ? callsite->getCalledFunction() : nullptr;
+            if (callee && !callee->isDeclaration()) {
+              need(callee);
+            }
+          }
+        }
+      }
+    }
+    return needed;
+  }
+
+  // Every function that uses a global may read its taint; any use other than
+  // loading from it may also taint it (stores, passing it to a callee, ...).
+  void findUsersOfGvar(Value* val, set<Function*>& readers, set<Function*>& writers) {
+    for (auto *U : val->users()) {
+      if (auto *inst = dyn_cast<Instruction>(U)) {
+        readers.insert(inst->getFunction());
+        llvm::LoadInst* load = dyn_cast<LoadInst>(inst);
+        if (!load || load->getPointerOperand() != val) {
+          writers.insert(inst->getFunction());
+        }
+      } else if (isa<ConstantExpr>(U)) {
+        findUsersOfGvar(U, readers, writers);
+      }
+    }
+  }
+
+  // Analyzes the functions given, or all those not reused, to the fixpoint.
+  size_t analyzeSccsInOrder(const vector<Function*>* funcs = nullptr) {
+    vector<char> sccStarted(funcWorkList.sccs.size(), funcs != nullptr);
+    if (funcs) {
+      for (Function* func : *funcs) {
+        funcWorkList.add(func);
+      }
+    } else if (!Resume || !resumeFromCheckpoint(sccStarted)) {
+      for (size_t ixScc = 0; ixScc < funcWorkList.sccs.size(); ixScc++) {
+        if (sccReused[ixScc]) {
+          sccStarted[ixScc] = true;
+          continue;
+        }
+        for (Function* func : funcWorkList.sccs[ixScc]) {
+          funcWorkList.add(func);
+        }
+      }
+    }
+
+    int round = 1;
+    size_t numAnalyzed = 0;
+    errs() << "Round " << (round++) << " (" << funcWorkList.size() << " functions in worklist, "
+           << funcWorkList.sccs.size() << " SCCs) \n";
+    bool checkpoints = (CheckpointFile != "" && !funcs);
+    auto lastCheckpoint = std::chrono::steady_clock::now();
+    while (!funcWorkList.empty()) {
+      if (funcWorkList.startsNewRound()) {
+        errs() << "Round " << (round++) << " (" << funcWorkList.size() << " functions in worklist) \n";
+        errs().flush();
+      }
+      int ixScc = funcWorkList.nextScc();
+      if (!sccStarted[ixScc]) {
+        sccStarted[ixScc] = true;
+        if (loadSccFromCache(ixScc)) {
+          funcWorkList.dropScc(ixScc);
+          continue;
+        }
+      }
+      Function* func = funcWorkList.pop();
+      set<Function*> invalidated;
+      analyzeFunc(*func, invalidated);
+      detectWrapper(*func);
+      set<Function*> promoted;
+      for (Function* stale : invalidated) {
+        if (!isReused(stale)) {
+          funcWorkList.add(stale);
+        } else if (inputsGrew(stale)) {
+          promoted.insert(stale);
+        }
+      }
+      for (Function* stale : promoteReused(promoted)) {
+        funcWorkList.add(stale);
+      }
+      numAnalyzed++;
+      if (checkpoints && secondsSince(lastCheckpoint) >= CheckpointInterval) {
+        if (!writeCheckpoint(CheckpointFile, sccStarted)) {
+          errs() << "Failed to write checkpoint '" << CheckpointFile << "'; no more checkpoints are written\n";
+          checkpoints = false;
+        }
+        lastCheckpoint = std::chrono::steady_clock::now();
+      }
+    }
+    // The checkpoint is only needed by an unfinished run.
+    if (CheckpointFile != "") {
+      sys::fs::remove(CheckpointFile);
+    }
+    return numAnalyzed;
+  }
+
+  // Saves the state of analyzeSccsInOrder() between two analyses: the
+  // summaries of the SCCs started, the taint of the globals and the worklist.
+  bool writeCheckpoint(const string& path, const vector<char>& sccStarted) {
+    TimeRegion timeCheckpoint(passStats.timer(PassStats::SUMMARY_CACHE));
+    vector<Function*> funcs;
+    vector<Function*> wroteGlobals;
+    vector<Function*> fromCache;
+    for (size_t ixScc = 0; ixScc < funcWorkList.sccs.size(); ixScc++) {
+      if (!sccStarted[ixScc]) {
+        continue;
+      }
+      const vector<Function*>& scc = funcWorkList.sccs[ixScc];
+      funcs.insert(funcs.end(), scc.begin(), scc.end());
+      if (sccWroteGlobals[ixScc]) {
+        wroteGlobals.push_back(scc.front());
+      }
+      if (sccFromCache[ixScc]) {
+        fromCache.push_back(scc.front());
+      }
+    }
+    std::shared_lock<std::shared_mutex> lock(AliasedTaintMap::globalSrcTaintMutex);
+    return summaryCache.writeCheckpoint(path, funcs, funcFlowsBySink, AliasedTaintMap::globalSrcTaintSet,
+                                        funcWorkList.pendingFuncs(), wroteGlobals, fromCache);
+  }
+
+  // Reuses the summaries saved in the -incremental file by the previous run
+  // for every function whose IR is unchanged, so that only the changed
+  // functions are analyzed at first, with the global taint of the previous
+  // run.  What a changed function added to globals may be gone, and may have
+  // spread through other globals to functions that are unchanged, so the
+  // globals it may write (before or after the change) are computed again
+  // from scratch, as are the globals whose taint can't be read back (see
+  // resetThroughGlobals()).  The reused functions whose callees or globals
+  // turn out different are analyzed too, as soon as those gain taint (see
+  // inputsGrew()) or else by checkIncremental().
+  void loadIncremental() {
+    if (!sys::fs::exists(IncrementalFile)) {
+      errs() << "No summaries saved in '" << IncrementalFile << "' yet\n";
+      return;
+    }
+    SummaryCache::Checkpoint saved;
+    string error;
+    if (!summaryCache.readCheckpoint(IncrementalFile, saved, error, /*partial=*/true)) {
+      errs() << "Not reusing the summaries in '" << IncrementalFile << "': " << error << "\n";
+      return;
+    }
+    for (auto const& [gv, writers] : fnsWritingGvar) {
+      for (Function* writer : writers) {
+        gvarsWrittenBy[writer].insert(gv);
+      }
+    }
+    for (auto const& [writer, gv] : saved.gvarWriters) {
+      gvarsWrittenBy[writer].insert(gv);
+    }
+    for (auto const& [func, callers] : callersOfFunc) {
+      for (Function* caller : callers) {
+        calleesOf[caller].push_back(func);
+      }
+    }
+    vector<vector<int>> depsOfScc(funcWorkList.sccs.size());
+    for (auto const& [func, ixScc] : funcWorkList.sccOfFunc) {
+      for (Function* caller : callersOfFunc[func]) {
+        depsOfScc[funcWorkList.sccOfFunc.at(caller)].push_back(ixScc);
+      }
+      for (GlobalVariable* gv : gvarsWrittenBy[func]) {
+        for (Function* reader : fnsReferencingGvar[gv]) {
+          auto itScc = funcWorkList.sccOfFunc.find(reader);
+          if (itScc != funcWorkList.sccOfFunc.end()) {
+            depsOfScc[itScc->second].push_back(ixScc);
+          }
+        }
+      }
+    }
+    groupOfScc.resize(funcWorkList.sccs.size());
+    for (vector<int>& group : SccWorkList::findSccs(depsOfScc)) {
+      for (int ixScc : group) {
+        groupOfScc[ixScc] = sccGroups.size();
+      }
+      sccGroups.push_back(group);
     }
 
-    // parse arg taint flows
-    argv.push_back(argname);
-    if (flow.size() > 3) // only other option (via. if statements above) is flow.size == 3
-    {
-      flow = flow.substr(2, flow.length()-4); // cut out whitespace and '[', ']'
-      // std::cout << "\tnew flow: |" << flow << "|" << std::endl;
-      split = " , ";
-      while ((pos = flow.find(split)) != std::string::npos)
-      {
-        std::string s = flow.substr(0, pos);
-        // std::cout << "\t\tfind: " << s << std::endl;
-        argv.push_back(s);
-        flow.erase(0, pos + split.length());
+    set<Function*> unchanged;
+    for (const SummaryCache::CachedSummary& summary : saved.summaries) {
+      unchanged.insert(summary.func);
+    }
+    vector<Function*> changed;
+    for (auto const& [func, ixScc] : funcWorkList.sccOfFunc) {
+      if (unchanged.count(func) == 0) {
+        changed.push_back(func);
       }
-      // std::cout << "\t\tfind: " << flow << std::endl; // last rhs of " , "
-      argv.push_back(flow);
     }
-    pair = std::make_pair(argname, argv);
-    // std::cout << "\tpair: " << std::get<0>(pair) << " | [";
-    // for (auto& item : std::get<1>(pair))
-    //   std::cout << item << ",";
-    // std::cout << "]" << std::endl;
-
-    return pair;
+    std::fill(sccReused.begin(), sccReused.end(), true);
+    for (Function* func : changed) {
+      sccReused[funcWorkList.sccOfFunc[func]] = false;
+    }
+    for (const SummaryCache::CachedSummary& summary : saved.summaries) {
+      FuncSummary_t& savedSummary = savedSummaryOf[summary.func];
+      for (auto const& [sink, sources] : summary.flowsBySink) {
+        savedSummary.sourcesOf(sink).insert(sources);
+      }
+      if (!isReused(summary.func)) {
+        continue;
+      }
+      FuncSummary_t& funcSummary = funcFlowsBySink.find(summary.func)->second;
+      for (auto const& [sink, sources] : summary.flowsBySink) {
+        funcSummary.noteGrowth(funcSummary.sourcesOf(sink).insert(sources));
+      }
+    }
+    for (auto const& [gv, sources] : saved.globalTaint) {
+      savedGlobalTaintOf[gv] = sources;
+      AliasedTaintMap::globalSrcTaintSet[gv].insert(sources);
+    }
+    resetThroughGlobals(changed, set<GlobalVariable*>(saved.staleGlobals.begin(), saved.staleGlobals.end()));
+    // Nothing has been analyzed with the summaries just reset.
+    promotedFuncs.clear();
+
+    size_t numReused = 0;
+    for (const SummaryCache::CachedSummary& summary : saved.summaries) {
+      if (isReused(summary.func)) {
+        detectWrapper(*summary.func);
+        numReused++;
+      }
+    }
+    for (Function* func : saved.wroteGlobals) {
+      if (isReused(func)) {
+        sccWroteGlobals[funcWorkList.sccOfFunc[func]] = true;
+      }
+    }
+    errs() << "Reusing the summaries of " << numReused << " of " << funcWorkList.sccOfFunc.size()
+           << " functions from '" << IncrementalFile << "' (" << changed.size() << " changed)\n";
   }
 
-  std::map<std::string, std::vector<std::pair<std::string, std::vector<std::string>>>> parse_taint_cp_file() {
-    // below data structure: {'libcfn': [('argname', ['taint_flows_to_argname',...?]),...]}
-    std::map<std::string, std::vector<std::pair<std::string, std::vector<std::string>>>> fnprototype_map;
-    std::string   line;
-    std::ifstream file{TaintCpFile};
+  // Whether F's summary is reused from the -incremental file, so that F is
+  // not analyzed.
+  bool isReused(Function* F) {
+    auto itScc = funcWorkList.sccOfFunc.find(F);
+    return itScc != funcWorkList.sccOfFunc.end() && sccReused[itScc->second];
+  }
 
-    if (!file.is_open())
-    {
-      std::cerr << "Failed to open file " << TaintCpFile << std::endl;
-      return fnprototype_map;
+  // Whether every flow of summary is in bound.
+  static bool flowsWithin(const FuncSummary_t& summary, const FuncSummary_t& bound) {
+    for (auto const& [sink, sources] : summary) {
+      const SensSrcSet_t* boundSources = bound.find(sink);
+      if (!sources.empty() && (!boundSources || !boundSources->contains(sources))) {
+        return false;
+      }
     }
+    return true;
+  }
 
-    // read file line by line
-    while (std::getline(file, line))
-    {
-      size_t pos, lpos, rpos;
-      std::string fnname, args;
-      std::vector<std::pair<std::string, std::vector<std::string>>> arg_list{};
+  // Whether F's summary has only flows of its summary in the previous run.
+  bool flowsWithinSaved(Function* F) {
+    auto itSaved = savedSummaryOf.find(F);
+    return itSaved != savedSummaryOf.end() && flowsWithin(funcFlowsBySink.find(F)->second, itSaved->second);
+  }
 
-      // std::cout << "Line: " << line << std::endl;
-      // get fnname
-      if ((pos = line.find(" ")) == std::string::npos ||
-          (lpos = line.find("(")) == std::string::npos ||
-          (rpos = line.find(")")) == std::string::npos)
-      {
-        std::cerr << TaintCpFile << " formatted incorrectly. Not parsing file" << std::endl;
-        return fnprototype_map;
-      }
-      fnname = line.substr(0, pos);
-      // std::cout << fnname << std::endl;
-      args   = line.substr(lpos+2, rpos-lpos-3);
-      // std::cout << args << "| " << args.size() << std::endl;
+  bool sameFlowsAsSaved(Function* F) {
+    auto itSaved = savedSummaryOf.find(F);
+    return flowsWithinSaved(F) && flowsWithin(itSaved->second, funcFlowsBySink.find(F)->second);
+  }
 
-      fnprototype_map[fnname] = arg_list;
+  // Whether the taint of gv has only sources it had in the previous run.
+  bool taintWithinSaved(GlobalVariable* gv) {
+    auto itTaint = AliasedTaintMap::globalSrcTaintSet.find(gv);
+    if (itTaint == AliasedTaintMap::globalSrcTaintSet.end()) {
+      return true;
+    }
+    auto itSaved = savedGlobalTaintOf.find(gv);
+    return (itSaved != savedGlobalTaintOf.end()) ? itSaved->second.contains(itTaint->second) : itTaint->second.empty();
+  }
 
-      std::string delim{" ]"};
-      while ((pos = args.find(delim)) != std::string::npos)
-      {
-        std::string s = args.substr(0, pos+2);
-        if (s[0] == ',')
-          s.erase(0, 2);
-        // std::cout << "find: " << s << std::endl;
-        fnprototype_map[fnname].push_back(parse_arg_string(s));
-        args.erase(0, pos + delim.length());
-      } // should be no string left
+  // Whether a reused function must be analyzed after all, because one of
+  // its callees or globals has gained taint since the previous run.
+  bool inputsGrew(Function* reused) {
+    for (Function* callee : calleesOf[reused]) {
+      if (!isReused(callee) && !flowsWithinSaved(callee)) {
+        return true;
+      }
     }
-    file.close();
-    return fnprototype_map;
+    for (GlobalVariable* gv : gvarsUsedBy[reused]) {
+      if (!taintWithinSaved(gv)) {
+        return true;
+      }
+    }
+    return false;
   }
 
-  void parse_taint_copiers(Module &M) {
-    std::map<std::string, std::vector<std::pair<std::string, std::vector<std::string>>>> fnprototype_map;
-    fnprototype_map = parse_taint_cp_file();
+  // Drops F's summary, to analyze F from scratch.  Widened summaries are
+  // final.
+  void resetFunc(Function* F) {
+    if (budgetsEnabled && budgetOf.find(F)->second.degradedBy) {
+      return;
+    }
+    funcFlowsBySink.find(F)->second.clear();
+    auto itWrapper = autoWrappers.find(F);
+    if (itWrapper != autoWrappers.end()) {
+      itWrapper->second = false;
+    }
+  }
 
-    // std::cout << "\n\nModule fns:" << std::endl;
-    // for (const llvm::Function& fn : M.getFunctionList())
-    //   std::cout << "Fn: " << fn.getName().data() << std::endl;
+  // Stops reusing the summaries of the SCCs of funcs, whose inputs grew.
+  // Their callers, and the functions that use the globals they may write,
+  // keep what they derived from the old summaries and taint until
+  // checkIncremental(), which resets them if some of it may be lost.
+  // Returns the functions to analyze.
+  vector<Function*> promoteReused(const set<Function*>& funcs) {
+    vector<Function*> promoted;
+    for (Function* func : funcs) {
+      int ixScc = funcWorkList.sccOfFunc.at(func);
+      if (!sccReused[ixScc]) {
+        continue;
+      }
+      sccReused[ixScc] = false;
+      for (Function* member : funcWorkList.sccs[ixScc]) {
+        resetFunc(member);
+        promotedFuncs.insert(member);
+        promotedGvars.insert(gvarsWrittenBy[member].begin(), gvarsWrittenBy[member].end());
+        promoted.push_back(member);
+      }
+    }
+    return promoted;
+  }
 
-    for (auto const& x : fnprototype_map)
-    {
-      std::string libcfn = x.first;
-      std::vector<std::pair<std::string, std::vector<std::string>>> val = x.second;
-      Function* libc_fnptr;
-      int idx;
-      std::map<std::string, int> argidx_map; // argument name to idx
+  // Resets funcs, whose summaries and the taint they added to globals may
+  // have lost sources, and everything that may have derived taint from them
+  // through globals: each global they may write is emptied, and each
+  // function using such a global is reset in turn.  So that taint that is
+  // gone can't keep circulating through the summaries left, each function
+  // is reset with its whole group of sccGroups, the SCCs that depend on each
+  // other through calls or globals.  The analyzed callers of analyzed
+  // functions reset are reset too; for reused ones, that is left to
+  // checkIncremental().  The globals of gvars are emptied as well.  Returns
+  // the functions to analyze.
+  vector<Function*> resetThroughGlobals(vector<Function*> workList, const set<GlobalVariable*>& gvars) {
+    set<Function*> toReset;
+    set<GlobalVariable*> toEmpty;
+    auto emptyGvar = [&](GlobalVariable* gv) {
+      if (toEmpty.insert(gv).second) {
+        const set<Function*>& users = fnsReferencingGvar[gv];
+        workList.insert(workList.end(), users.begin(), users.end());
+      }
+    };
+    for (GlobalVariable* gv : gvars) {
+      emptyGvar(gv);
+    }
+    while (!workList.empty()) {
+      Function* func = workList.back();
+      workList.pop_back();
+      auto itScc = funcWorkList.sccOfFunc.find(func);
+      if (itScc == funcWorkList.sccOfFunc.end() || !toReset.insert(func).second) {
+        continue;
+      }
+      for (int ixScc : sccGroups[groupOfScc[itScc->second]]) {
+        const vector<Function*>& scc = funcWorkList.sccs[ixScc];
+        workList.insert(workList.end(), scc.begin(), scc.end());
+      }
+      if (!isReused(func)) {
+        for (Function* caller : callersOfFunc[func]) {
+          if (!isReused(caller)) {
+            workList.push_back(caller);
+          }
+        }
+      }
+      for (GlobalVariable* gv : gvarsWrittenBy[func]) {
+        emptyGvar(gv);
+      }
+    }
 
-      argidx_map["return"] = RETVAL_CODE;
+    for (GlobalVariable* gv : toEmpty) {
+      AliasedTaintMap::globalSrcTaintSet[gv] = SensSrcSet_t();
+    }
+    for (Function* func : toReset) {
+      if (isReused(func)) {
+        promotedFuncs.insert(func);
+      }
+    }
+    for (Function* func : toReset) {
+      sccReused[funcWorkList.sccOfFunc.at(func)] = false;
+      resetFunc(func);
+    }
+    return vector<Function*>(toReset.begin(), toReset.end());
+  }
 
-      if (!(libc_fnptr = M.getFunction(libcfn)))
-      {
-        bool found = false;
-        // handle llvm intrinsic functions like memcpy
-        // llvm.memcpy.p0i8.p0i8.i64 for memcpy (.p0i8.p0i8.i64 might not be per architecture, [.p0i8.p0i8.i32?]) so only use initial 'llvm.'+name
-        for (llvm::Function& fn : M.getFunctionList())
-        {
-          std::string fnname = fn.getName().data();
-          std::string intrinsic_fn = "llvm." + libcfn;
-          if ( intrinsic_fn.length() <= fnname.length() && fnname.substr(0, intrinsic_fn.length()) == intrinsic_fn )
-          {
-            found = true;
-            libc_fnptr = &fn;
-            break;
+  // Once a pass of an -incremental analysis reaches its fixpoint, checks
+  // that its result is that of a full analysis, and returns the functions to
+  // analyze in another pass if not.  Through resetThroughGlobals(), these
+  // are reset:
+  //  - the analyzed callers of promoted functions that lost flows, and the
+  //    globals the functions promoted by promoteReused() may write, as they
+  //    may have added less to them than in the previous run;
+  //  - then the reused functions whose callees or globals are not the same
+  //    as in the previous run.
+  vector<Function*> checkIncremental() {
+    vector<Function*> lostFlows;
+    for (Function* func : promotedFuncs) {
+      auto itSaved = savedSummaryOf.find(func);
+      if (itSaved != savedSummaryOf.end() && !flowsWithin(itSaved->second, funcFlowsBySink.find(func)->second)) {
+        for (Function* caller : callersOfFunc[func]) {
+          if (!isReused(caller)) {
+            lostFlows.push_back(caller);
           }
         }
-        if (!found)
+      }
+    }
+    promotedFuncs.clear();
+    vector<Function*> pending = resetThroughGlobals(lostFlows, promotedGvars);
+    promotedGvars.clear();
+
+    // The functions just reset are checked in the next pass.
+    set<Function*> justReset(pending.begin(), pending.end());
+    set<Function*> stale;
+    for (size_t ixScc = 0; ixScc < funcWorkList.sccs.size(); ixScc++) {
+      for (Function* func : funcWorkList.sccs[ixScc]) {
+        if (sccReused[ixScc] || justReset.count(func) || sameFlowsAsSaved(func)) {
           continue;
+        }
+        for (Function* caller : callersOfFunc[func]) {
+          if (isReused(caller)) {
+            stale.insert(caller);
+          }
+        }
       }
-      knownExtFuncs.insert(libc_fnptr);
-      taintCopiers.insert(libc_fnptr);
-
-      // index arguments first because we refer 'back' at them. otherwise, this would cause an error:
-      // fn ( arg1 -> [ arg2 ], arg2 -> [] )
-      idx = 0;
-      for (std::pair<std::string, std::vector<std::string>>& p : val)
-      {
-        argidx_map[std::get<0>(p)] = idx++;
+    }
+    set<GlobalVariable*> gvars;
+    for (auto const& [gv, sources] : savedGlobalTaintOf) {
+      gvars.insert(gv);
+    }
+    for (auto const& [loc, sources] : AliasedTaintMap::globalSrcTaintSet) {
+      if (GlobalVariable* gv = dyn_cast<GlobalVariable>(loc)) {
+        gvars.insert(gv);
       }
-
-      idx = 0;
-      for (std::pair<std::string, std::vector<std::string>>& p : val)
-      {
-        std::string argname;
-        Sink_t arg_sink;
-
-        argname = std::get<0>(p);
-        // std::cout << "\t" << argname << ": [";
-        arg_sink = {libc_fnptr, idx++, nullptr};
-        // arg_sink = {libc_fnptr, idx, nullptr};
-        // argidx_map[argname] = idx++;
-        for (std::string flowname : std::get<1>(p))
-        {
-          SensSrc_t arg_src;
-          arg_src = {libc_fnptr, argidx_map[flowname], nullptr};
-          funcFlowsBySink[libc_fnptr][arg_src].insert(arg_sink);
-          // funcFlowsBySink[libc_fnptr][arg_sink].insert(arg_src);
-          // make argsrc w/ index from argidx_map
-          // std::cout << flowname << ",";
+    }
+    for (GlobalVariable* gv : gvars) {
+      auto itTaint = AliasedTaintMap::globalSrcTaintSet.find(gv);
+      SensSrcSet_t taint = (itTaint == AliasedTaintMap::globalSrcTaintSet.end()) ? SensSrcSet_t() : itTaint->second;
+      if (taint == savedGlobalTaintOf.lookup(gv)) {
+        continue;
+      }
+      for (Function* reader : fnsReferencingGvar[gv]) {
+        if (isReused(reader)) {
+          stale.insert(reader);
         }
-        // std::cout << "]\n";
       }
-
-      // printFuncSummary(*libc_fnptr);
     }
-    // std::cout << std::endl;
+    for (Function* func : resetThroughGlobals(vector<Function*>(stale.begin(), stale.end()), {})) {
+      pending.push_back(func);
+    }
+    return pending;
   }
 
-
-  void populate_sources_and_sinks_2(Module &M) {
-    std::string filename = SourcesAndSinksFile;
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-      std::cerr << "Failed to open file " << filename << std::endl;
-      return;
+  // Restores the state saved by writeCheckpoint(), if the checkpoint is of
+  // this module and configuration.  Returns false, having changed nothing,
+  // if the analysis has to start over.
+  bool resumeFromCheckpoint(vector<char>& sccStarted) {
+    TimeRegion timeCheckpoint(passStats.timer(PassStats::SUMMARY_CACHE));
+    SummaryCache::Checkpoint checkpoint;
+    string error;
+    if (CheckpointFile == "") {
+      error = "-resume needs -checkpoint";
+    } else if (summaryCache.readCheckpoint(CheckpointFile, checkpoint, error)) {
+      // The SCCs started must have all their functions saved, and the others
+      // must have all their functions pending.
+      vector<size_t> numSavedOf(funcWorkList.sccs.size());
+      vector<size_t> numPendingOf(funcWorkList.sccs.size());
+      for (auto [funcs, numOf] : {pair{&checkpoint.pending, &numPendingOf}, {&checkpoint.wroteGlobals, nullptr},
+                                  {&checkpoint.fromCache, nullptr}}) {
+        for (Function* func : *funcs) {
+          if (funcWorkList.sccOfFunc.count(func) == 0) {
+            error = "function '" + func->getName().str() + "' is not analyzed";
+          } else if (numOf) {
+            (*numOf)[funcWorkList.sccOfFunc[func]]++;
+          }
+        }
+      }
+      for (const SummaryCache::CachedSummary& saved : checkpoint.summaries) {
+        if (funcWorkList.sccOfFunc.count(saved.func) == 0) {
+          error = "function '" + saved.func->getName().str() + "' is not analyzed";
+        } else {
+          numSavedOf[funcWorkList.sccOfFunc[saved.func]]++;
+        }
+      }
+      for (size_t ixScc = 0; ixScc < funcWorkList.sccs.size() && error.empty(); ixScc++) {
+        size_t sccSize = funcWorkList.sccs[ixScc].size();
+        if (numSavedOf[ixScc] != (numSavedOf[ixScc] ? sccSize : 0) ||
+            (numSavedOf[ixScc] == 0 && numPendingOf[ixScc] != sccSize)) {
+          error = "the call graph has changed";
+        }
+      }
+    }
+    if (!error.empty()) {
+      errs() << "Not resuming from '" << CheckpointFile << "': " << error << "\n";
+      return false;
     }
 
-    vector<string> foundFuncs;
-    vector<string> missingFuncs;
-
-    std::string line;
-    while (std::getline(file, line)) {
-      std::istringstream iss(line);
-      std::string type, funcName;
-
-      // Read the function name
-      iss >> funcName;
-
-      Function* func = M.getFunction(funcName);
-      if (!func) {
-        missingFuncs.push_back(funcName);
-        continue;
+    for (const SummaryCache::CachedSummary& saved : checkpoint.summaries) {
+      FuncSummary_t& summary = funcFlowsBySink.find(saved.func)->second;
+      for (auto const& [sink, sources] : saved.flowsBySink) {
+        summary.noteGrowth(summary.sourcesOf(sink).insert(sources));
       }
-      knownExtFuncs.insert(func);
-      foundFuncs.push_back(funcName);
-
-      funcArgSrcCat[func].resize(func->arg_size());
-      // Variadic functions get 1 more sink type for their variadic args
-      funcArgSinkCat[func].resize(func->arg_size() + (func->isVarArg() ? 1 : 0));
+      detectWrapper(*saved.func);
+      sccStarted[funcWorkList.sccOfFunc[saved.func]] = true;
+    }
+    for (auto const& [gv, sources] : checkpoint.globalTaint) {
+      AliasedTaintMap::globalSrcTaintSet[gv].insert(sources);
+    }
+    for (Function* func : checkpoint.pending) {
+      funcWorkList.add(func);
+    }
+    for (Function* func : checkpoint.wroteGlobals) {
+      sccWroteGlobals[funcWorkList.sccOfFunc[func]] = true;
+    }
+    for (Function* func : checkpoint.fromCache) {
+      sccFromCache[funcWorkList.sccOfFunc[func]] = true;
+    }
+    errs() << "Resumed from '" << CheckpointFile << "' (" << checkpoint.summaries.size()
+           << " functions summarized)\n";
+    return true;
+  }
 
-      // Read all arguments for this function
-      std::string curcat;
-      ssize_t ixArg = -1;
-      while (iss >> curcat) {
-        ixArg++;
-        bool isRet = false;
-        if (curcat == "-"s) {
-          continue;
-        } else if (curcat == "->"s) {
-          iss >> curcat;
-          isRet = true;
-        } else if ((size_t)ixArg >= func->arg_size() && !func->isVarArg()) {
-          outs() << "Error: " << funcName << ": too many arguments!\n";
-          continue;
+  // Iterates the pending functions of one SCC to their fixpoint, bottom-up.
+  // The functions outside the SCC that analyzeFunc invalidates, i.e., its
+  // callers and the readers of the globals it grew, are returned in
+  // invalidatedOutside.
+  size_t analyzeScc(int ixScc, set<unsigned> pending, set<Function*>& invalidatedOutside) {
+    size_t numAnalyzed = 0;
+    while (!pending.empty()) {
+      Function* func = funcWorkList.sccs[ixScc][*pending.begin()];
+      pending.erase(pending.begin());
+      set<Function*> invalidated;
+      analyzeFunc(*func, invalidated);
+      detectWrapper(*func);
+      for (Function* stale : invalidated) {
+        if (funcWorkList.sccOfFunc.at(stale) == ixScc) {
+          pending.insert(funcWorkList.ixInScc.lookup(stale));
+        } else {
+          invalidatedOutside.insert(stale);
         }
+      }
+      numAnalyzed++;
+    }
+    return numAnalyzed;
+  }
 
-        int taint_cat = AUX_TYPE_MAIN;
-        bool isSrc = false;
-        bool isSink = false;
-        if (curcat.substr(0,4) == "File"s) {
-          curcat = curcat.substr(4, curcat.size());
-          taint_cat = AUX_TYPE_FILE;
+  // Analyzes each SCC on a thread pool as soon as all the SCCs it calls are
+  // finished.  A function invalidated through a global joins the current
+  // round if its SCC has not started yet, and the next one otherwise; rounds
+  // are repeated until nothing is pending.  Since the analysis still reaches
+  // the same fixpoint, the results are identical to the single-threaded run.
+  size_t analyzeSccsInParallel(unsigned numThreads, const vector<Function*>* funcs = nullptr) {
+    size_t numSccs = funcWorkList.sccs.size();
+    std::mutex readyMutex;
+    vector<size_t> numUnfinishedDeps(numSccs);
+    vector<set<unsigned>> pendingOf(numSccs);
+    vector<set<unsigned>> nextPendingOf(numSccs);
+    vector<char> started(numSccs);
+    vector<char> triedCache(numSccs);
+    std::atomic<size_t> numAnalyzed(0);
+    llvm::ThreadPool pool(llvm::hardware_concurrency(numThreads));
+
+    // Each task analyzes the lowest-numbered ready SCC, so that the SCCs
+    // writing globals tend to run before those reading them, as in the
+    // single-threaded order.
+    set<int> readySccs;
+    set<Function*> reusedInvalidated; // promoted between rounds if their inputs grew
+    std::function<void()> runNextScc = [&]() {
+      int ixScc;
+      set<unsigned> pending;
+      bool tryCache = false;
+      {
+        std::lock_guard<std::mutex> lock(readyMutex);
+        ixScc = *readySccs.begin();
+        readySccs.erase(readySccs.begin());
+        started[ixScc] = true;
+        pending.swap(pendingOf[ixScc]);
+        tryCache = !pending.empty() && !triedCache[ixScc];
+        triedCache[ixScc] = triedCache[ixScc] || tryCache;
+      }
+      set<Function*> invalidatedOutside;
+      if (!tryCache || !loadSccFromCache(ixScc)) {
+        numAnalyzed += analyzeScc(ixScc, std::move(pending), invalidatedOutside);
+      }
+      std::lock_guard<std::mutex> lock(readyMutex);
+      for (Function* stale : invalidatedOutside) {
+        if (isReused(stale)) {
+          reusedInvalidated.insert(stale);
+          continue;
         }
-        if (curcat == "Src"s) {
-          isSrc = true;
-        } else if (curcat == "Sink"s) {
-          isSink = true;
-        } else if (curcat == "SrcAndSink"s) {
-          isSrc = true;
-          isSink = true;
-        } else if (curcat == "none"s) {
-          // do nothing in this case
-        } else {
-          outs() << "Error: unrecognized catcode '" << curcat << "', function " << funcName << "\n";
+        int ixStale = funcWorkList.sccOfFunc.at(stale);
+        unsigned ixFunc = funcWorkList.ixInScc.lookup(stale);
+        (started[ixStale] ? nextPendingOf : pendingOf)[ixStale].insert(ixFunc);
+      }
+      for (int ixDependent : funcWorkList.dependentSccsOf[ixScc]) {
+        if (--numUnfinishedDeps[ixDependent] == 0) {
+          readySccs.insert(ixDependent);
+          pool.async(runNextScc);
         }
-        if (isRet) {
-          if (isSrc) {
-            funcRetCat[func] = taint_cat;
-          }
-          if (isSink) {
-            outs() << "Error: " << funcName << ": return value cannot be a sink!\n";
-          }
-        } else {
-          if (isSrc) {
-            funcArgSrcCat[func][ixArg] = taint_cat;
-            // llvm::outs() << "Reading src: " << llvm::demangle(func->getName().data()) << " (" << func->getName() << ")\n";
-          }
-          if (isSink) {
-            funcArgSinkCat[func][ixArg] = taint_cat;
-            // llvm::outs() << "Reading sink: " << llvm::demangle(func->getName().data()) << " (" << func->getName() << ")\n";
+      }
+    };
+
+    for (size_t ixScc = 0; ixScc < numSccs; ixScc++) {
+      if (sccReused[ixScc] || funcs) {
+        triedCache[ixScc] = true;
+        continue;
+      }
+      for (unsigned ixFunc = 0; ixFunc < funcWorkList.sccs[ixScc].size(); ixFunc++) {
+        pendingOf[ixScc].insert(ixFunc);
+      }
+    }
+    for (Function* func : funcs ? *funcs : vector<Function*>()) {
+      pendingOf[funcWorkList.sccOfFunc.at(func)].insert(funcWorkList.ixInScc.lookup(func));
+    }
+    int round = 1;
+    while (std::any_of(pendingOf.begin(), pendingOf.end(), [](const set<unsigned>& pending) { return !pending.empty(); })) {
+      if (round > 1) {
+        errs() << "Round " << round << "\n";
+      }
+      round++;
+      {
+        std::lock_guard<std::mutex> lock(readyMutex);
+        std::fill(started.begin(), started.end(), false);
+        for (size_t ixScc = 0; ixScc < numSccs; ixScc++) {
+          numUnfinishedDeps[ixScc] = funcWorkList.depSccsOf[ixScc].size();
+        }
+        for (size_t ixScc = 0; ixScc < numSccs; ixScc++) {
+          if (numUnfinishedDeps[ixScc] == 0) {
+            readySccs.insert(ixScc);
+            pool.async(runNextScc);
           }
         }
-
       }
+      pool.wait();
+      for (size_t ixScc = 0; ixScc < numSccs; ixScc++) {
+        pendingOf[ixScc].insert(nextPendingOf[ixScc].begin(), nextPendingOf[ixScc].end());
+        nextPendingOf[ixScc].clear();
+      }
+      std::erase_if(reusedInvalidated, [&](Function* func) { return !inputsGrew(func); });
+      for (Function* func : promoteReused(reusedInvalidated)) {
+        pendingOf[funcWorkList.sccOfFunc.at(func)].insert(funcWorkList.ixInScc.lookup(func));
+      }
+      reusedInvalidated.clear();
+    }
+    return numAnalyzed;
+  }
 
+  // The analysis time of the slowest chain of SCCs that call each other.
+  // SCCs are numbered callees first, so each one's callees are done first.
+  double criticalPathSeconds() {
+    vector<double> finish(funcWorkList.sccs.size());
+    double criticalPath = 0;
+    for (size_t ixScc = 0; ixScc < funcWorkList.sccs.size(); ixScc++) {
+      for (int ixDep : funcWorkList.depSccsOf[ixScc]) {
+        finish[ixScc] = max(finish[ixScc], finish[ixDep]);
+      }
+      for (Function* func : funcWorkList.sccs[ixScc]) {
+        finish[ixScc] += passStats.of(func)->seconds;
+      }
+      criticalPath = max(criticalPath, finish[ixScc]);
     }
-    outs() << "Found " << foundFuncs.size() << " source/sink functions in program; " << missingFuncs.size() << " are absent.\n";
+    return criticalPath;
+  }
 
-    file.close();
+  void findGlobalsUsedBy(Value* val, set<GlobalVariable*>& gvars) {
+    if (GlobalVariable* gv = dyn_cast<GlobalVariable>(val)) {
+      gvars.insert(gv);
+    } else if (ConstantExpr* constExpr = dyn_cast<ConstantExpr>(val)) {
+      for (Value* op : constExpr->operands()) {
+        findGlobalsUsedBy(op, gvars);
+      }
+    }
   }
 
-  void populate_wrappers(Module &M) {
-    std::string filename = WrappersFile; //"/host_dmc/gpt/wrappers.txt";
-    if (WrappersFile == "") {
-      errs() << "No wrappers file specified.\n";
-      return;
+  // The summary cache key of an SCC, or "" if the SCC cannot be cached.
+  // Only valid once all the SCCs it depends on are finished.  Besides the
+  // callees' summaries, it covers the taint of the globals the SCC reads;
+  // SCCs that write taint to globals are never stored.
+  string sccCacheKey(int ixScc) {
+    vector<Function*> members = funcWorkList.sccs[ixScc];
+    set<Function*> callees;
+    set<GlobalVariable*> gvars;
+    for (Function* func : members) {
+      if (!func->hasName()) {
+        return "";
+      }
+      for (auto &B : *func) {
+        for (auto &I : B) {
+          CallBase* callsite = dyn_cast<CallBase>(&I);
+          if (callsite && callsite->getCalledFunction()) {
+            callees.insert(callsite->getCalledFunction());
+          }
+          for (Value* op : I.operands()) {
+            findGlobalsUsedBy(op, gvars);
+          }
+        }
+      }
     }
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-      errs() << "Failed to open wrappers file '" << filename << "'\n";
-      return;
+    auto byName = [](Value* lhs, Value* rhs) { return lhs->getName() < rhs->getName(); };
+    std::sort(members.begin(), members.end(), byName);
+    vector<Function*> sortedCallees(callees.begin(), callees.end());
+    std::sort(sortedCallees.begin(), sortedCallees.end(), byName);
+    vector<GlobalVariable*> sortedGvars(gvars.begin(), gvars.end());
+    std::sort(sortedGvars.begin(), sortedGvars.end(), byName);
+    string keyText = summaryCache.configHash + "\n";
+    for (Function* func : members) {
+      keyText += "member " + func->getName().str() + " " + summaryCache.irHashOf.lookup(func) + "\n";
     }
-    std::string line;
-    while (std::getline(file, line)) {
-      std::istringstream iss(line);
-      std::string funcName;
-      iss >> funcName;
-      Function* func = M.getFunction(funcName);
-      if (!func) {
-        outs() << "Failed to find wrapper function " << funcName << "\n";
-      } else {
-        wrapperFuncs.insert(func);
+    for (Function* callee : sortedCallees) {
+      if (std::find(members.begin(), members.end(), callee) != members.end()) {
+        continue;
+      }
+      if (callee->isDeclaration()) {
+        keyText += "extern " + callee->getName().str() + "\n";
+        continue;
       }
+      string summaryHash = summaryCache.summaryHash(callee, funcFlowsBySink.find(callee)->second);
+      if (summaryHash.empty()) {
+        return "";
+      }
+      keyText += "callee " + callee->getName().str() + " " + summaryHash + "\n";
     }
-    file.close();
+    std::shared_lock<std::shared_mutex> lock(AliasedTaintMap::globalSrcTaintMutex);
+    for (GlobalVariable* gv : sortedGvars) {
+      auto itTaint = AliasedTaintMap::globalSrcTaintSet.find(gv);
+      if (itTaint == AliasedTaintMap::globalSrcTaintSet.end()) {
+        continue;
+      }
+      string taintHash = summaryCache.sourcesHash(itTaint->second);
+      if (!gv->hasName() || taintHash.empty()) {
+        return "";
+      }
+      keyText += "global " + gv->getName().str() + " " + taintHash + "\n";
+    }
+    return SummaryCache::md5Hex(keyText);
   }
 
+  // Loads the summaries of an SCC that is about to be analyzed from the
+  // summary cache.  Returns false if it has to be analyzed after all.
+  bool loadSccFromCache(int ixScc) {
+    if (!summaryCache.enabled()) {
+      return false;
+    }
+    string key = sccCacheKey(ixScc);
+    vector<SummaryCache::CachedSummary> cached;
+    if (key.empty() || !summaryCache.load(key, funcWorkList.sccs[ixScc], cached)) {
+      return false;
+    }
+    for (const SummaryCache::CachedSummary& cachedSummary : cached) {
+      FuncSummary_t& summary = funcFlowsBySink.find(cachedSummary.func)->second;
+      for (auto const& [sink, sources] : cachedSummary.flowsBySink) {
+        summary.noteGrowth(summary.sourcesOf(sink).insert(sources));
+      }
+      detectWrapper(*cachedSummary.func);
+    }
+    sccFromCache[ixScc] = true;
+    return true;
+  }
 
-  void plugInSummary(CallBase* callsite, TaintMapType& taintOfVal) {
-    llvm::Function* callee = callsite->getCalledFunction();
-    llvm::Function* caller = callsite->getFunction();
-    if (!callee) {return;}
-    for (auto const& [sumSink, sumSources] : funcFlowsBySink[callee]) {
-      Value* valToTaint = nullptr;
-      SensSrcSet_t* pTaintDest;
-      if (sumSink.callsite == nullptr) {
-        assert(sumSink.func == callee);
-        if (sumSink.ixArg == RETVAL_CODE) {
-          valToTaint = callsite;
-        } else {
-          valToTaint = callsite->getArgOperand(sumSink.ixArg);
-        }
-        pTaintDest = nullptr; //&taintOfVal[valToTaint];
-      } else {
-        if (wrapperFuncs.count(callee)) {
-          int wrapperArgIx = 0; // TODO: FIXME!!!
-          SrcOrSink_t* pSumSink = storeScrink(sumSink);
-          SensSrc_t sink = {callee, wrapperArgIx, callsite, sumSink.auxType, (SrcOrSink_t*)(pSumSink)};
-          pTaintDest = &funcFlowsBySink[caller][sink];
-        } else {
-          pTaintDest = &funcFlowsBySink[caller][sumSink];
-        }
+  // Whether any function of the SCC was degraded by a budget; the summaries
+  // of such SCCs are never cached.
+  bool sccDegraded(int ixScc) {
+    for (Function* func : funcWorkList.sccs[ixScc]) {
+      auto itBudget = budgetOf.find(func);
+      if (itBudget != budgetOf.end() && itBudget->second.degradedBy) {
+        return true;
       }
-      for (const SensSrc_t& sumSrc : asSingleSet(sumSources)) {
-        //errs() << "sumSrc = ";
-        //dumpSrcOrSink(errs(), sumSrc, nullptr);
-        //errs() << "\n";
-        if (!sumSrc.isSummaryScrink()) {
-          if (sumSink.callsite != nullptr) {
-            // Do nothing; no need to propagate fully concrete flows upwards.
-          } else {
-            SensSrc_t insSrc;
-            if (wrapperFuncs.count(callee)) {
-              int wrapperArgIx = 0; // TODO: FIXME!!!
-              SrcOrSink_t* pSumSrc = storeScrink(sumSrc);
-              SensSrc_t src = {callee, wrapperArgIx, callsite, sumSrc.auxType, (SrcOrSink_t*)(pSumSrc)};
-              insSrc = src;
-            } else {
-              insSrc = sumSrc;
-            }
-            if (pTaintDest) {
-              pTaintDest->insert(insSrc);
-            } else {
-              taintOfVal.addTaint(valToTaint, insSrc);
-            }
-          }
-        } else {
-          assert(sumSrc.func == callee);
-          assert(sumSrc.ixArg != RETVAL_CODE) ;
-          Value* actArg = callsite->getArgOperand(sumSrc.ixArg);
-          if (pTaintDest) {
-            extendWith(*pTaintDest, taintOfVal.getTaintAsSingleSet(actArg));
-          } else {
-            taintOfVal.addTaintSet(valToTaint, taintOfVal.getTaintAsSingleSet(actArg));
-          }
-        }
+    }
+    return false;
+  }
+
+  void reportDegradedFuncs(Module& M) {
+    vector<Function*> degraded;
+    for (Function& F : M) {
+      auto itBudget = budgetOf.find(&F);
+      if (itBudget != budgetOf.end() && itBudget->second.degradedBy) {
+        degraded.push_back(&F);
       }
     }
+    if (degraded.empty()) {
+      return;
+    }
+    errs() << "Widened the summaries of " << degraded.size() << " functions over budget:\n";
+    for (Function* F : degraded) {
+      errs() << "  " << F->getName() << " (" << budgetOf.find(F)->second.degradedBy << ")\n";
+    }
   }
 
-  set<Function*> findCallers(Function *callee) {
-    set<Function*> hit;
-    for (auto *U : callee->users()) {
-      if (auto *callInst = dyn_cast<CallInst>(U)) {
-        Function *caller = callInst->getFunction();
-        hit.insert(caller); // sets do not contain duplicates
+  // Stores the summaries of every analyzed SCC that can be cached.
+  void saveSummaryCache() {
+    size_t numLoaded = 0;
+    for (size_t ixScc = 0; ixScc < funcWorkList.sccs.size(); ixScc++) {
+      if (sccFromCache[ixScc]) {
+        numLoaded++;
+        continue;
+      }
+      if (sccWroteGlobals[ixScc] || sccDegraded(ixScc)) {
+        continue;
+      }
+      string key = sccCacheKey(ixScc);
+      if (!key.empty()) {
+        summaryCache.store(key, funcWorkList.sccs[ixScc], funcFlowsBySink);
       }
     }
-    return hit;
+    errs() << "Loaded " << numLoaded << " of " << funcWorkList.sccs.size() << " SCCs from the summary cache\n";
   }
 
 #if USE_OLD_PASS_MANAGER
@@ -917,97 +4043,185 @@ public:
   PreservedAnalyses run(Module &M, ModuleAnalysisManager &MAM)
 #endif
   {
-
-    //populate_sources_and_sinks_1(M);
-    populate_sources_and_sinks_2(M);
-    populate_wrappers(M);
-    parse_taint_copiers(M);
-    funcWorkList.add(nullptr);
-    map<Function*, set<Function*>> calleesOfFunc;
-    for (Function &F : M) {
-      calleesOfFunc[&F];
+    if (ConnectFlows && OutputFormat != OUTPUT_TEXT) {
+      optionError("-connect-flows only supports -output-format=text");
+    }
+    passStats.init(M, PrintTaintStats || TaintStatsJsonFile != "");
+    for (const string& name : OnlySinks) {
+      queriedSinks.insert(name);
     }
+    passStats.start(PassStats::SPECS);
+    loadSpecs(M);
+    passStats.stop(PassStats::SPECS);
+    passStats.start(PassStats::CALL_GRAPH);
+    // Create every per-function entry up front; during analysis these maps
+    // are only looked up, so concurrent analyses never restructure them.
     for (Function &F : M) {
-      if (F.isDeclaration()) {
+      funcFlowsBySink[&F];
+      if (!F.isDeclaration()) {
+        continue;
+      }
+      funcArgSrcCat[&F];
+      funcArgSinkCat[&F];
+      funcRetCat[&F];
+      if (F.getName().startswith(StringRef("llvm.")) || knownExtFuncs.count(&F)) {
         continue;
       }
-      callersOfFunc[&F] = findCallers(&F);
-      for (Function* caller : callersOfFunc[&F]) {
-        if (caller != &F) {
-          calleesOfFunc[caller].insert(&F);
+      for (auto *U : F.users()) {
+        CallBase* callsite = dyn_cast<CallBase>(U);
+        if (callsite && callsite->getCalledFunction() == &F) {
+          unknownExtFuncs.insert(&F);
+          break;
         }
       }
     }
-    
-    //outs() << "Size = " << calleesOfFunc.size() << "\n";
-    {
-      int count=0;
-      for (bool isStuck=false; isStuck==false && count < 20; ) {
-        count++;
-        isStuck = true;
-        int numScheduled = 0;
-        for (auto const& [func, callees] : calleesOfFunc) {
-          if (funcWorkList.workSet.count(func)) {
-            continue;
-          }
-          if (callees.size() == 0) {
-            funcWorkList.add(func);
-            numScheduled++;
-            isStuck = false;
-            for (Function* caller : callersOfFunc[func]) {
-              calleesOfFunc[caller].erase(func);
-            }
-          }
-        }
-        //outs() << "Count = " << count << ", numScheduled = " << numScheduled << ", WorkList size = " << funcWorkList.workList.size() << "\n";
+    checkQueriedSinks(M);
+    findConnectedAuxSinks(M);
+
+    // Dependency graph for scheduling: a function depends on its callees and
+    // on the globals it reads; a global depends on the functions that may
+    // write it.
+    vector<Function*> definedFuncs;
+    map<Value*, set<Value*>> depsOf;
+    for (Function &F : M) {
+      if (F.isDeclaration()) {
+        continue;
       }
-      // count = 0;
-      // for (auto const& [func, callees] : calleesOfFunc) {
-      //   if (funcWorkList.workSet.count(func)) {continue;}
-      //   if (callees.size() == 0) {continue;}
-      //   outs() << func->getName() << ": " << (*callees.begin())->getName() << "\n";
-      //   //if (count++ > 20) {break;};
-      // }
-      for (Function &F : M) {
-        if (F.isDeclaration()) {continue;}
-        funcWorkList.add(&F);
+      definedFuncs.push_back(&F);
+    }
+    for (Function* F : definedFuncs) {
+      callersOfFunc[F] = findCallers(F);
+      for (Function* caller : callersOfFunc[F]) {
+        depsOf[caller].insert(F);
       }
     }
-
-    int round = 1;
-    while (!funcWorkList.empty()) {
-      Function* func = funcWorkList.pop();
-      if (func == nullptr) {
-        if (!funcWorkList.empty()) {
-          funcWorkList.add(nullptr);
-        }
-        errs() << "Round " << (round++) << " (" << funcWorkList.workList.size() << " functions in worklist) \n";
-        errs().flush();
+    for (llvm::GlobalVariable &gv : M.globals()) {
+      if (gv.isConstant()) {
         continue;
       }
-      analyzeFunc(*func);
+      set<Function*>& writers = fnsWritingGvar[&gv];
+      findUsersOfGvar(&gv, fnsReferencingGvar[&gv], writers);
+      for (Function* reader : fnsReferencingGvar[&gv]) {
+        depsOf[reader].insert(&gv);
+        gvarsUsedBy[reader].push_back(&gv);
+      }
+      depsOf[&gv].insert(writers.begin(), writers.end());
     }
-    outs() << "\n############################################################\n";
-    outs() << "# Function summaries\n";
-    outs() << "############################################################\n";
-    for (Function &F : M) {
-      if (F.isDeclaration()) {continue;}
-      printFuncSummary(F);
+    passStats.stop(PassStats::CALL_GRAPH);
+
+    passStats.start(PassStats::SCHEDULING);
+    demoteRecursiveWrappers(M, depsOf);
+    if (AutoWrappers) {
+      findWrapperCandidates(definedFuncs, depsOf);
     }
-    outs() << "\n############################################################\n";
-    outs() << "# FULL FLOWS\n";
-    outs() << "############################################################\n";
-    for (Function &F : M) {
-      if (F.isDeclaration()) {continue;}
-      printFuncTaints(F);
+    // Every function may be called from another TU, so none is pruned.
+    if ((DemandDriven || !OnlySinks.empty()) && TuSummaryFile == "") {
+      set<Value*> needed = findNodesOnSinkFlows(definedFuncs, depsOf);
+      size_t numFuncs = definedFuncs.size();
+      erase_if(definedFuncs, [&](Function* F) {return needed.count(F) == 0;});
+      // Skipped functions must never be invalidated by the analysis.
+      auto isSkipped = [&](Function* F) {return needed.count(F) == 0;};
+      for (auto& [F, callers] : callersOfFunc) {
+        erase_if(callers, isSkipped);
+      }
+      for (auto& [gv, readers] : fnsReferencingGvar) {
+        erase_if(readers, isSkipped);
+      }
+      errs() << "Skipping " << (numFuncs - definedFuncs.size()) << " functions that can't be on a flow into a sink\n";
+    }
+    funcWorkList.build(definedFuncs, depsOf);
+    sccWroteGlobals.assign(funcWorkList.sccs.size(), false);
+    sccFromCache.assign(funcWorkList.sccs.size(), false);
+    sccReused.assign(funcWorkList.sccs.size(), false);
+    passStats.stop(PassStats::SCHEDULING);
+    if (SummaryCacheDir != "" || CheckpointFile != "" || IncrementalFile != "") {
+      TimeRegion timeCache(passStats.timer(PassStats::SUMMARY_CACHE));
+      summaryCache.init(M, SummaryCacheDir, {SourcesAndSinksFile, TaintCpFile, SpecDbFile, WrappersFile},
+                        string(TuSummaryFile != "" ? "tu" : "program") +
+                        (WrapperDepth ? " wrapper-depth " + to_string(WrapperDepth) : "") +
+                        (AutoWrappers ? " auto-wrappers" : ""));
     }
 
-    outs() << "\n############################################################\n";
-    outs() << "Unrecognized external functions: [ ";
-    for (Function* func : unknownExtFuncs) {
-      outs() << func->getName() << " ";
+    budgetsEnabled = (FuncTimeBudget > 0 || FuncAnalysisBudget > 0 || SummarySizeBudget > 0 ||
+                      TimeBudget > 0 || MemoryBudget > 0);
+    if (budgetsEnabled) {
+      for (Function* F : definedFuncs) {
+        budgetOf[F];
+      }
+    }
+    if (IncrementalFile != "") {
+      TimeRegion timeCache(passStats.timer(PassStats::SUMMARY_CACHE));
+      loadIncremental();
+    }
+    analysisStart = std::chrono::steady_clock::now();
+
+    passStats.start(PassStats::ANALYSIS);
+    size_t numAnalyzed;
+    unsigned numThreads = (TaintThreads == 0) ? llvm::hardware_concurrency().compute_thread_count() : TaintThreads;
+    if (numThreads > 1 && CheckpointFile != "") {
+      errs() << "Checkpoints are only written by the single-threaded analysis; ignoring -taint-threads\n";
+      numThreads = 1;
+    }
+    if (numThreads > 1) {
+      errs() << "Analyzing " << definedFuncs.size() << " functions (" << funcWorkList.sccs.size()
+             << " SCCs) with " << numThreads << " threads\n";
+      numAnalyzed = analyzeSccsInParallel(numThreads);
+    } else {
+      numAnalyzed = analyzeSccsInOrder();
+    }
+    while (IncrementalFile != "") {
+      vector<Function*> promoted = checkIncremental();
+      if (promoted.empty()) {
+        break;
+      }
+      errs() << "Analyzing again " << promoted.size() << " functions whose callees or globals changed\n";
+      numAnalyzed += (numThreads > 1) ? analyzeSccsInParallel(numThreads, &promoted) : analyzeSccsInOrder(&promoted);
+    }
+    passStats.stop(PassStats::ANALYSIS);
+    if (passStats.enabled) {
+      passStats.criticalPathSeconds = criticalPathSeconds();
+    }
+    errs() << "Analyzed " << definedFuncs.size() << " functions (" << numAnalyzed << " analyses)\n";
+    reportDegradedFuncs(M);
+    if (summaryCache.enabled()) {
+      TimeRegion timeCache(passStats.timer(PassStats::SUMMARY_CACHE));
+      saveSummaryCache();
+    }
+    if (IncrementalFile != "") {
+      TimeRegion timeCache(passStats.timer(PassStats::SUMMARY_CACHE));
+      // Widened summaries are not reused, as by the summary cache.
+      vector<char> sccSaved(funcWorkList.sccs.size());
+      for (size_t ixScc = 0; ixScc < funcWorkList.sccs.size(); ixScc++) {
+        sccSaved[ixScc] = !sccDegraded(ixScc);
+      }
+      if (!writeCheckpoint(IncrementalFile, sccSaved)) {
+        errs() << "Failed to save the summaries to '" << IncrementalFile << "'\n";
+      }
+    }
+    if (TuSummaryFile != "") {
+      TimeRegion timePrint(passStats.timer(PassStats::PRINT_SUMMARIES));
+      writeTuSummary(M);
+    }
+    if (WriteWrappersFile != "") {
+      writeWrappers(M);
     }
-    outs() << "]\n";
+    passStats.start(PassStats::PRINT_FLOWS);
+    findConnectedAuxCalls(M);
+    if (OutputFile != "" && OutputFile != "-") {
+      std::error_code err;
+      raw_fd_ostream os(OutputFile, err);
+      if (err) {
+        errs() << "Failed to open output file '" << OutputFile << "': " << err.message() << "\n";
+      } else {
+        // Written in large chunks; the output can be hundreds of MB.
+        os.SetBufferSize(1 << 20);
+        printOutput(os, M);
+      }
+    } else {
+      printOutput(outs(), M);
+    }
+    passStats.stop(PassStats::PRINT_FLOWS);
+    passStats.report(TaintStatsJsonFile, PrintTaintStats);
     #if USE_OLD_PASS_MANAGER
     return true;
     #else
@@ -1051,7 +4265,7 @@ public:
   }
 
 
-  inline void analyzeInst(llvm::Instruction* inst, Function* func, TaintMapType& taintOfVal, set<llvm::GlobalVariable*>& gvarSet) {
+  inline void analyzeInst(llvm::Instruction* inst, Function* func, TaintMapType& taintOfVal) {
     bool is_cmp = (inst->getOpcode() == llvm::Instruction::ICmp ||
                    inst->getOpcode() == llvm::Instruction::FCmp);
     if (is_cmp) {
@@ -1081,92 +4295,294 @@ public:
 	  {
 	    plugInSummary(callsite, taintOfVal);
 	  }
+          if (TuSummaryFile != "" && unknownExtFuncs.count(callee)) {
+            addExternCallPlaceholders(callsite, func, taintOfVal);
+          }
           // If a func has only a decl, then it's an external function.
+          // (The category maps are filled in for every declaration before
+          // analysis starts, so lookups here never modify them.)
+          const vector<int>& argSinkCats = funcArgSinkCat.find(callee)->second;
           for (int arg=0; arg < callsite->arg_size(); arg++) {
-            int sink_arg = arg >= funcArgSinkCat[callee].size() ? funcArgSinkCat[callee].size() - 1 : arg;
+            int sink_arg = arg >= argSinkCats.size() ? argSinkCats.size() - 1 : arg;
             // All variadic fns must have >=1 fixed arg
             if (sink_arg == -1) {break;}
-            int auxType = funcArgSinkCat[callee][sink_arg];
+            int auxType = argSinkCats[sink_arg];
             if (auxType == AUX_TYPE_NULL) {continue;}
             Sink_t sink = {callee, arg, callsite, auxType};
             // if ((sink == <passThruGep(callsite->getArgOperand(arg))>))
-            funcFlowsBySink[func][sink] = taintOfVal.getTaintAsSingleSet(callsite->getArgOperand(arg));
-            llvm::GlobalVariable* gv = llvm::dyn_cast<llvm::GlobalVariable>(passThruGep(callsite->getArgOperand(arg)));
-            if (gv && !gv->isConstant()) {
-              fnsReferencingGvar[gv].insert(callsite->getFunction()); // callsite->getFunction() = caller
-              gvarSet.insert(gv);
-              // llvm::outs() << "Added global taint at " << *callsite << " for " << gv->getName() << "(" << !gv->isConstant() << ")\n";
+            // Union rather than overwrite: through a recursive cycle, a
+            // callee's summary plugged in at another call also adds to this
+            // sink, and the last of the two visits must not drop the other.
+            FuncSummary_t& summary = funcFlowsBySink.find(func)->second;
+            summary.noteGrowth(taintOfVal.unionTaintInto(summary.sourcesOf(sink), callsite->getArgOperand(arg)));
+          }
+          // bool flag = false;
+          const vector<int>& argSrcCats = funcArgSrcCat.find(callee)->second;
+          for (int arg=-1; arg < (ssize_t) argSrcCats.size(); arg++) {
+            int auxType;
+            if (arg == RETVAL_CODE) {
+              auxType = funcRetCat.find(callee)->second;
+            } else {
+              auxType = argSrcCats[arg];
+            }
+            if (auxType == AUX_TYPE_NULL) {
+              continue;
+            }
+            // flag = true;
+            SensSrc_t src = {callee, arg, callsite, auxType};
+            if (arg == RETVAL_CODE) {
+              taintOfVal.addTaint(callsite, src);
+            } else {
+              taintOfVal.addTaint(callsite->getArgOperand(arg), src);
             }
           }
-          if (callee->getName().startswith(StringRef("llvm."))) {
-            // TODO
-          } else {
-            if (knownExtFuncs.count(callee) == 0) {
-              unknownExtFuncs.insert(callee);
+          // if (flag) {
+          //   errs() << "\n=====================\n" <<
+          //     "FUNCTION CALL " << callee->getName() << "\n";
+          //   taintOfVal.dump();
+          // }
+        } else {
+          plugInSummary(callsite, taintOfVal);
+        }
+      }
+    }
+    else if (inst->getOpcode() == llvm::Instruction::Store) {
+      llvm::StoreInst* store = dyn_cast<StoreInst>(inst);
+      taintOfVal.addTaintFrom(store->getPointerOperand(), store->getValueOperand());
+    }
+    else if (PHINode* phi = dyn_cast<PHINode>(inst)) {
+      for (Value* incoming : phi->incoming_values()) {
+        taintOfVal.addAlias(phi, incoming);
+      }
+      goto normal_inst;
+    }
+    else {
+      normal_inst:
+      for (auto op = inst->op_begin(); op != inst->op_end(); ++op) {
+        Value *operand = *op;
+        taintOfVal.addTaintFrom(inst, operand);
+      }
+    }
+  }
+
+  // Whether the time or memory budget of the whole analysis is exceeded;
+  // once it is, it stays so.
+  bool globalBudgetsExceeded() {
+    if (globalBudgetExceeded) {
+      return true;
+    }
+    const char* exceeded = nullptr;
+    if (TimeBudget > 0 && secondsSince(analysisStart) > TimeBudget) {
+      exceeded = "time budget";
+    } else if (MemoryBudget > 0 && sys::Process::GetMallocUsage() > (size_t(MemoryBudget) << 20)) {
+      exceeded = "memory budget";
+    }
+    const char* none = nullptr;
+    if (exceeded && globalBudgetExceeded.compare_exchange_strong(none, exceeded)) {
+      errs() << "Exceeded the " << exceeded << "; widening the summaries of the functions left\n";
+    }
+    return globalBudgetExceeded != nullptr;
+  }
+
+  static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  // Widens F's summary once a budget is exceeded, so that it covers whatever
+  // a full analysis of F would find: every source F can produce (its
+  // arguments, the sources of the calls it makes, those its callees'
+  // summaries bring in, and the taint of the globals it uses) is assumed to
+  // flow into its return value, its arguments, the globals it may write and
+  // every sink it calls.  F is not analyzed again, only widened again when
+  // its callees or globals grow.
+  void widenFunc(Function& F, FuncSummary_t& summary, TaintMapType& taintOfVal) {
+    SensSrcSet_t sources;
+    for (int ixArg = 0; ixArg < (int)F.arg_size(); ixArg++) {
+      sources.insert((SensSrc_t){&F, ixArg, nullptr});
+    }
+    // The flows found so far include those of F's recursive calls.
+    vector<Sink_t> sinks;
+    for (auto const& [sink, sinkSources] : summary) {
+      sources.insert(sinkSources);
+      sinks.push_back(sink);
+    }
+    vector<GlobalVariable*> writtenGvars;
+    auto itGvars = gvarsUsedBy.find(&F);
+    for (GlobalVariable* gv : (itGvars == gvarsUsedBy.end()) ? vector<GlobalVariable*>() : itGvars->second) {
+      taintOfVal.unionTaintInto(sources, gv);
+      if (fnsWritingGvar.find(gv)->second.count(&F)) {
+        writtenGvars.push_back(gv);
+      }
+    }
+    // Flows of callee summaries that pass through as they are, as in
+    // plugInSummary().
+    vector<pair<Sink_t, SensSrc_t>> calleeFlows;
+    for (auto &B : F) {
+      for (auto &I : B) {
+        CallBase* callsite = dyn_cast<CallBase>(&I);
+        Function* callee = callsite ? callsite->getCalledFunction() : nullptr;
+        if (!callee) {
+          continue;
+        }
+        for (int ixArg = 0; ixArg < (int)callsite->arg_size(); ixArg++) {
+          Value* arg = callsite->getArgOperand(ixArg);
+          llvm::ConstantExpr* ce = llvm::dyn_cast<llvm::ConstantExpr>(arg);
+          if (ce && looks_like_filename(getStringFromConstantExpr(ce))) {
+            sources.insert((SensSrc_t){.auxType=AUX_TYPE_MAIN, .auxConst=arg});
+          }
+        }
+        if (callee->isDeclaration()) {
+          const vector<int>& argSinkCats = funcArgSinkCat.find(callee)->second;
+          for (int arg = 0; arg < (int)callsite->arg_size(); arg++) {
+            int sink_arg = min(arg, (int)argSinkCats.size() - 1);
+            if (sink_arg == -1) {break;}
+            if (argSinkCats[sink_arg] != AUX_TYPE_NULL) {
+              sinks.push_back({callee, arg, callsite, argSinkCats[sink_arg]});
+            }
+          }
+          const vector<int>& argSrcCats = funcArgSrcCat.find(callee)->second;
+          for (int arg = RETVAL_CODE; arg < (ssize_t) argSrcCats.size(); arg++) {
+            int auxType = (arg == RETVAL_CODE) ? funcRetCat.find(callee)->second : argSrcCats[arg];
+            if (auxType != AUX_TYPE_NULL) {
+              sources.insert((SensSrc_t){callee, arg, callsite, auxType});
+            }
+          }
+          if (TuSummaryFile != "" && unknownExtFuncs.count(callee)) {
+            for (int arg = RETVAL_CODE; arg < (ssize_t) callsite->arg_size(); arg++) {
+              if (arg != RETVAL_CODE) {
+                sinks.push_back({callee, arg, callsite, AUX_TYPE_EXT_IN});
+              }
+              sources.insert((SensSrc_t){callee, arg, callsite, AUX_TYPE_EXT_OUT});
             }
-            //sinkSites.insert(callsite);
           }
-          // bool flag = false;
-          for (int arg=-1; arg < (ssize_t) funcArgSrcCat[callee].size(); arg++) {
-            int auxType;
-            if (arg == RETVAL_CODE) {
-              auxType = funcRetCat[callee];
-            } else {
-              auxType = funcArgSrcCat[callee][arg];
+        }
+        if ((callee->isDeclaration() && !taintCopiers.count(callee)) || callee == &F) {
+          continue;
+        }
+        for (auto const& [sumSink, sumSources] : funcFlowsBySink.find(callee)->second) {
+          bool concreteSink = (sumSink.callsite != nullptr);
+          Sink_t sink = (concreteSink && isWrapper(callee)) ? *wrapScrink(callee, callsite, sumSink) : sumSink;
+          for (const SensSrc_t& sumSrc : sumSources) {
+            if (sumSrc.isSummaryScrink()) {
+              // The sink receives the caller's taint.
+              if (concreteSink) {
+                sinks.push_back(sink);
+              }
+              continue;
             }
-            if (auxType == AUX_TYPE_NULL) {
+            if (concreteSink && !sumSink.isPlaceholder() && !sumSrc.isPlaceholder()) {
               continue;
             }
-            // flag = true;
-            SensSrc_t src = {callee, arg, callsite, auxType};
-            if (arg == RETVAL_CODE) {
-              taintOfVal.addTaint(callsite, src);
+            SensSrc_t src = isWrapper(callee) ? *wrapScrink(callee, callsite, sumSrc) : sumSrc;
+            if (concreteSink) {
+              calleeFlows.push_back({sink, src});
             } else {
-              if (taintOfVal.addTaint(callsite->getArgOperand(arg), src)) {
-                llvm::GlobalVariable* gv = llvm::dyn_cast<llvm::GlobalVariable>(passThruGep(callsite->getArgOperand(arg)));
-                if (!gv->isConstant()) {
-                  fnsReferencingGvar[gv].insert(callsite->getFunction()); // callsite->getFunction() = caller
-                  gvarSet.insert(gv);
-                  // llvm::outs() << "Added global taint at " << *callsite << " for " << gv->getName() << "(" << !gv->isConstant() << ")\n";
-                }
-              }
+              sources.insert(src);
             }
           }
-          // if (flag) {
-          //   errs() << "\n=====================\n" <<
-          //     "FUNCTION CALL " << callee->getName() << "\n";
-          //   taintOfVal.dump();
-          // }
-        } else {
-          plugInSummary(callsite, taintOfVal);
         }
       }
     }
-    else if (inst->getOpcode() == llvm::Instruction::Store) {
-      llvm::StoreInst* store = dyn_cast<StoreInst>(inst);
-      taintOfVal.addTaintSet(store->getPointerOperand(),
-          taintOfVal.getTaintAsSingleSet(store->getValueOperand()));
+
+    for (int ixOut = RETVAL_CODE; ixOut < (int)F.arg_size(); ixOut++) {
+      sinks.push_back({&F, ixOut, nullptr});
     }
-    else if (PHINode* phi = dyn_cast<PHINode>(inst)) {
-      for (Value* incoming : phi->incoming_values()) {
-        taintOfVal.addAlias(phi, incoming);
-      }
-      goto normal_inst;
+    for (const Sink_t& sink : sinks) {
+      summary.noteGrowth(summary.sourcesOf(sink).insert(sources));
     }
-    else {
-      normal_inst:
-      for (auto op = inst->op_begin(); op != inst->op_end(); ++op) {
-        Value *operand = *op;
-        SensSrcSet_t operandTaint = taintOfVal.getTaintAsSingleSet(operand);
-        taintOfVal.addTaintSet(inst, operandTaint);
+    for (auto const& [sink, src] : calleeFlows) {
+      summary.noteGrowth(summary.sourcesOf(sink).insert(src));
+    }
+    for (GlobalVariable* gv : writtenGvars) {
+      taintOfVal.addTaintSet(gv, sources);
+    }
+  }
+
+  // The budget that a function has exceeded after an analysis, if any
+  const char* budgetExceeded(const FuncSummary_t& summary, const FuncBudget& budget) {
+    if (FuncTimeBudget > 0 && budget.seconds > FuncTimeBudget) {
+      return "function time budget";
+    }
+    if (FuncAnalysisBudget > 0 && budget.numAnalyses >= FuncAnalysisBudget) {
+      return "function analysis budget";
+    }
+    if (SummarySizeBudget > 0 && summarySize(summary) > SummarySizeBudget) {
+      return "summary size budget";
+    }
+    return globalBudgetsExceeded() ? globalBudgetExceeded.load() : nullptr;
+  }
+
+  size_t summarySize(const FuncSummary_t& summary) {
+    size_t size = 0;
+    for (auto const& [sink, sources] : summary) {
+      size += sources.size();
+    }
+    return size;
+  }
+
+  // Adds to `invalidated` every function whose analysis may have been made
+  // stale by F's new summary or by taint F stored into globals.
+  void noteChanges(Function& F, bool summaryChanged, TaintMapType& taintOfVal, set<Function*>& invalidated) {
+    if (summaryChanged) {
+      const set<Function*>& callers = callersOfFunc.find(&F)->second;
+      invalidated.insert(callers.begin(), callers.end());
+    }
+    // Taint stored into globals is visible to every function that reads
+    // them, whether or not our own summary changed.
+    if (taintOfVal.wroteGlobals) {
+      sccWroteGlobals[funcWorkList.sccOfFunc.at(&F)] = true;
+    }
+    for (llvm::GlobalVariable* gv : taintOfVal.grownGlobals) {
+      auto itReaders = fnsReferencingGvar.find(gv);
+      if (itReaders == fnsReferencingGvar.end()) {
+        continue;
+      }
+      for (llvm::Function* fn : itReaders->second) {
+        if (fn != &F) {
+          invalidated.insert(fn);
+        }
       }
     }
   }
 
-  void analyzeFunc(llvm::Function &F) {
-    map<Sink_t, SensSrcSet_t> oldSummary = funcFlowsBySink[&F]; // deep copy
+  // Counts one analysis of a function in its -taint-stats entry.
+  void countAnalysis(PassStats::FuncStats* stats, const FuncSummary_t& summary,
+      const TaintMapType& taintOfVal, uint64_t numInstVisits,
+      std::chrono::steady_clock::time_point startTime) {
+    stats->numAnalyses++;
+    stats->numInstVisits += numInstVisits;
+    stats->numUnions += taintOfVal.numUnions;
+    stats->peakSummarySize = max(stats->peakSummarySize, summarySize(summary));
+    stats->seconds += secondsSince(startTime);
+  }
+
+  // Analyzes F and adds to `invalidated` every function whose analysis may
+  // have been made stale by F's new summary or by taint F stored into
+  // globals.  Only F's own entry of funcFlowsBySink is written, so functions
+  // in independent SCCs can be analyzed concurrently.
+  void analyzeFunc(llvm::Function &F, set<Function*>& invalidated) {
+    FuncSummary_t& summary = funcFlowsBySink.find(&F)->second;
+    unsigned oldVersion = summary.version;
+    PassStats::FuncStats* stats = passStats.of(&F);
+    auto startTime = std::chrono::steady_clock::now();
+    uint64_t numInstVisits = 0;
+    FuncBudget* budget = budgetsEnabled ? &budgetOf.find(&F)->second : nullptr;
+    const char* exceeded = nullptr;
     TaintMapType taintOfVal;
-    set<llvm::GlobalVariable*> gvarSet;
+    // With the global budgets exceeded, a function is analyzed at most once
+    // more, and that analysis is cut short.  A widened function is only
+    // widened again, to take in what its callees and globals gained.
+    if (budget && !budget->degradedBy && budget->numAnalyses > 0 && globalBudgetsExceeded()) {
+      budget->degradedBy = globalBudgetExceeded;
+    }
+    if (budget && budget->degradedBy) {
+      widenFunc(F, summary, taintOfVal);
+      noteChanges(F, summary.version != oldVersion, taintOfVal, invalidated);
+      if (stats) {
+        countAnalysis(stats, summary, taintOfVal, numInstVisits, startTime);
+      }
+      return;
+    }
     // Each argument is tainted with itself.
     {
       int ixArg = -1;
@@ -1176,20 +4592,42 @@ public:
       }
     }
 
-    //bool isDirty = true;
-    //set<CallInst*> sinkSites;
-    while (true) {
-      size_t sizeAtStart = taintOfVal.calcSize();
-      //isDirty = false;
-      for (auto &B : F) {
-        for (auto &I : B) {
-          analyzeInst(&I, &F, taintOfVal, gvarSet);
+    // Sparse propagation: after one pass over the whole function, an
+    // instruction is only re-analyzed when a location it read (including
+    // memory written by a store and read by a load) has grown.
+    WorkList<Instruction*> instWorkList;
+    for (auto &B : F) {
+      for (auto &I : B) {
+        instWorkList.add(&I);
+      }
+    }
+    while (!instWorkList.empty()) {
+      if (budget && numInstVisits % 1024 == 1023) {
+        if (FuncTimeBudget > 0 && budget->seconds + secondsSince(startTime) > FuncTimeBudget) {
+          exceeded = "function time budget";
+          break;
+        }
+        if (globalBudgetsExceeded()) {
+          exceeded = globalBudgetExceeded;
+          break;
         }
       }
-      if (sizeAtStart == taintOfVal.calcSize()) {
-        break;
+      Instruction* inst = instWorkList.pop();
+      numInstVisits++;
+      taintOfVal.currentReader = inst;
+      analyzeInst(inst, &F, taintOfVal);
+      for (Value* loc : taintOfVal.grownLocs) {
+        auto itReaders = taintOfVal.readersOf.find(loc);
+        if (itReaders == taintOfVal.readersOf.end()) {
+          continue;
+        }
+        for (Instruction* reader : itReaders->second) {
+          instWorkList.add(reader);
+        }
       }
+      taintOfVal.grownLocs.clear();
     }
+    taintOfVal.currentReader = nullptr;
 
     // Look at all the "return" instructions in the fuction
     SensSrcSet_t retTaint;
@@ -1199,80 +4637,517 @@ public:
         if (!ret) {continue;}
         Value* retVal = ret->getReturnValue();
         if (retVal == nullptr) {continue;}
-        extendWith(retTaint, taintOfVal.getTaintAsSingleSet(retVal));
+        taintOfVal.unionTaintInto(retTaint, retVal);
       }
     }
 
     // Taint of return value
     Sink_t retSink = {&F, RETVAL_CODE, nullptr};
-    funcFlowsBySink[&F][retSink] = retTaint;
+    summary.noteGrowth(summary.sourcesOf(retSink).insert(retTaint));
 
     // Taint of "OUT"/"INOUT" arguments
     for (int ixArg=0; ixArg < F.arg_size(); ixArg++) {
       Sink_t argSink = {&F, ixArg, nullptr};
-      funcFlowsBySink[&F][argSink] = taintOfVal.getTaintAsSingleSet(F.getArg(ixArg));
+      summary.noteGrowth(taintOfVal.unionTaintInto(summary.sourcesOf(argSink), F.getArg(ixArg)));
     }
 
-    if (oldSummary != funcFlowsBySink[&F]) {
-      set<llvm::Function*> noRepeats;
-      for (Function* caller : callersOfFunc[&F]) {
-        funcWorkList.add(caller);
-        // outs() << "Adding caller *" << caller->getName() << "* of " << F.getName() << " for analysis\n";
+    if (budget) {
+      budget->numAnalyses++;
+      budget->seconds += secondsSince(startTime);
+      if (!exceeded) {
+        exceeded = budgetExceeded(summary, *budget);
       }
-      for (llvm::GlobalVariable* gv : gvarSet)
-      {
-        for (llvm::Function* fn : fnsReferencingGvar[gv]) {
-          // no repeat analysis on this function we just analyzed or on any of the recently added callers of the recently analyzed function
-          if (callersOfFunc[&F].count(fn) == 0 && fn != &F)
-          {
-            funcWorkList.add(fn);
-            // llvm::outs() << "Adding \"" << gv->getName() << "\" user " << fn->getName() << " for analysis\n";
+      if (exceeded) {
+        budget->degradedBy = exceeded;
+        widenFunc(F, summary, taintOfVal);
+      }
+    }
+    noteChanges(F, summary.version != oldVersion, taintOfVal, invalidated);
+
+    if (stats) {
+      countAnalysis(stats, summary, taintOfVal, numInstVisits, startTime);
+    }
+    return;
+
+  }
+
+  // The sinks of F's summary, in a deterministic order for printing.
+  vector<Sink_t> sortedSinksOf(Function& F) {
+    vector<Sink_t> sinks;
+    for (auto const& [sink, taints] : funcFlowsBySink[&F]) {
+      sinks.push_back(sink);
+    }
+    std::sort(sinks.begin(), sinks.end());
+    return sinks;
+  }
+
+  // Writes the summaries of the TU's defined functions for merge_summaries.py:
+  // for each function, its sinks with their sources, as positions in a table
+  // of scrinks.  Real sources and sinks are stored as they would be printed,
+  // summary scrinks and placeholders as the parameter or call they stand for.
+  void writeTuSummary(Module& M) {
+    std::error_code err;
+    raw_fd_ostream os(TuSummaryFile, err);
+    if (err) {
+      errs() << "Failed to open TU summary file '" << TuSummaryFile << "': " << err.message() << "\n";
+      return;
+    }
+    vector<SrcOrSink_t> scrinks;
+    DenseMap<SrcOrSink_t, unsigned> ixOfScrink;
+    DenseMap<CallBase*, unsigned> ixOfCallsite;
+    auto ixOf = [&](const SrcOrSink_t& scrink) {
+      auto [itIx, isNew] = ixOfScrink.insert({scrink, (unsigned)scrinks.size()});
+      if (isNew) {
+        scrinks.push_back(scrink);
+      }
+      return itIx->second;
+    };
+    json::OStream J(os, 1);
+    J.object([&] {
+      J.attribute("module", M.getModuleIdentifier());
+      J.attributeArray("functions", [&] {
+        for (Function &F : M) {
+          if (F.isDeclaration()) {continue;}
+          J.object([&] {
+            J.attribute("name", F.getName());
+            J.attribute("external", !F.hasLocalLinkage());
+            // Each flow is [sink, source, source, ...].
+            J.attributeArray("flows", [&] {
+              for (const Sink_t& sink : sortedSinksOf(F)) {
+                J.array([&] {
+                  J.value(ixOf(sink));
+                  for (const SensSrc_t& src : asSingleSet(funcFlowsBySink[&F].sourcesOf(sink))) {
+                    J.value(ixOf(src));
+                  }
+                });
+              }
+            });
+          });
+        }
+      });
+      J.attributeArray("scrinks", [&] {
+        for (const SrcOrSink_t& scrink : scrinks) {
+          J.object([&] {
+            if (scrink.isSummaryScrink()) {
+              J.attribute("kind", "param");
+              J.attribute("func", scrink.func->getName());
+              J.attribute("arg", scrink.ixArg);
+            } else if (scrink.isPlaceholder()) {
+              J.attribute("kind", getAuxName(scrink.auxType));
+              J.attribute("func", scrink.func->getName());
+              J.attribute("arg", scrink.ixArg);
+              J.attribute("callsite", ixOfCallsite.insert({scrink.callsite, ixOfCallsite.size()}).first->second);
+            } else {
+              string text;
+              raw_string_ostream textOs(text);
+              string indent = "      ";
+              dumpSrcOrSink(textOs, scrink, &indent);
+              J.attribute("kind", "real");
+              J.attribute("aux", getAuxName(scrink.auxType));
+              J.attribute("const", scrink.auxConst != nullptr);
+              J.attribute("json", textOs.str());
+            }
+          });
+        }
+      });
+    });
+    os << "\n";
+  }
+
+  void printOutput(raw_ostream& os, Module& M) {
+    if (OutputFormat == OUTPUT_JSON_LINES) {
+      writeJsonLines(os, M);
+      return;
+    }
+    if (OutputFormat == OUTPUT_BINARY) {
+      writeBinary(os, M);
+      return;
+    }
+    if (ConnectFlows) {
+      printConnectedFlows(os, M);
+      return;
+    }
+    os << "\n############################################################\n";
+    os << "# Function summaries\n";
+    os << "############################################################\n";
+    // The rest of the output is timed as printing flows by the caller.
+    passStats.stop(PassStats::PRINT_FLOWS);
+    passStats.start(PassStats::PRINT_SUMMARIES);
+    for (Function &F : M) {
+      if (F.isDeclaration()) {continue;}
+      printFuncSummary(os, F);
+    }
+    passStats.stop(PassStats::PRINT_SUMMARIES);
+    passStats.start(PassStats::PRINT_FLOWS);
+    os << "\n############################################################\n";
+    os << "# FULL FLOWS\n";
+    os << "############################################################\n";
+    for (Function &F : M) {
+      if (F.isDeclaration()) {continue;}
+      printFuncTaints(os, F);
+    }
+
+    os << "\n############################################################\n";
+    os << "Unrecognized external functions: [ ";
+    for (Function* func : unknownExtFuncs) {
+      os << func->getName() << " ";
+    }
+    os << "]\n";
+  }
+
+  // JSON Lines output (-output-format=jsonl): one record per line, each
+  // with a "kind": a "summary" per function, a "flow" per sink with
+  // concrete sources (the FULL FLOWS), and at the end the "unrecognized"
+  // external functions.
+  void writeJsonLines(raw_ostream& os, Module& M) {
+    auto sourcesArray = [&](json::OStream& J, const SensSrcSet_t& taints) {
+      J.array([&] {
+        for (const SensSrc_t& src : asSingleSet(taints)) {
+          writeScrinkJson(J, src, true);
+        }
+      });
+    };
+    for (Function &F : M) {
+      if (F.isDeclaration()) {continue;}
+      FuncSummary_t& summary = funcFlowsBySink[&F];
+      json::OStream J(os);
+      J.object([&] {
+        J.attribute("kind", "summary");
+        J.attribute("function", F.getName());
+        J.attributeBegin("return");
+        sourcesArray(J, summary.sourcesOf({&F, RETVAL_CODE, nullptr}));
+        J.attributeEnd();
+        J.attributeArray("args", [&] {
+          int ixArg = -1;
+          for (auto &Arg : F.args()) {
+            ixArg++;
+            J.object([&] {
+              J.attribute("name", Arg.getName());
+              J.attributeBegin("taint");
+              sourcesArray(J, summary.sourcesOf({&F, ixArg, nullptr}));
+              J.attributeEnd();
+            });
           }
+        });
+        // Sinks reached by the parameters, which are reported in callers.
+        J.attributeArray("sinks", [&] {
+          for (const Sink_t& sink : sortedSinksOf(F)) {
+            if (sink.callsite == nullptr || sink.ixArg == RETVAL_CODE || sink.isPlaceholder()) {
+              continue;
+            }
+            SensSrcSet_t halfTaints;
+            for (const SensSrc_t& taint : summary.sourcesOf(sink)) {
+              if (taint.isSummaryScrink()) {
+                halfTaints.insert(taint);
+              }
+            }
+            if (halfTaints.empty()) {
+              continue;
+            }
+            J.object([&] {
+              J.attributeBegin("sink");
+              writeScrinkJson(J, sink, true);
+              J.attributeEnd();
+              J.attributeBegin("sources");
+              sourcesArray(J, halfTaints);
+              J.attributeEnd();
+            });
+          }
+        });
+      });
+      os << "\n";
+    }
+    for (Function &F : M) {
+      if (F.isDeclaration()) {continue;}
+      for (const Sink_t& sink : sortedSinksOf(F)) {
+        SensSrcSet_t fullTaints;
+        if (!getFullTaints(F, sink, fullTaints)) {
+          continue;
         }
+        json::OStream J(os);
+        J.object([&] {
+          J.attribute("kind", "flow");
+          J.attribute("function", F.getName());
+          J.attributeBegin("sink");
+          writeScrinkJson(J, sink, true);
+          J.attributeEnd();
+          J.attributeBegin("sources");
+          sourcesArray(J, fullTaints);
+          J.attributeEnd();
+        });
+        os << "\n";
       }
     }
+    json::OStream J(os);
+    J.object([&] {
+      J.attribute("kind", "unrecognized");
+      J.attributeArray("functions", [&] {
+        for (Function* func : unknownExtFuncs) {
+          J.value(func->getName());
+        }
+      });
+    });
+    os << "\n";
+  }
 
-    return;
+  // The same fields as dumpSrcOrSink, with the callsite always given as
+  // [file, function, line, column].
+  void writeScrinkJson(json::OStream& J, const SrcOrSink_t& src, bool withWrapped) {
+    J.object([&] {
+      if (src.auxConst) {
+        J.attribute("aux_file", getStringFromConstantExpr(src.auxConst));
+        return;
+      }
+      if (src.func) {
+        J.attribute("func", src.func->getName());
+      } else {
+        J.attribute("func", nullptr);
+      }
+      J.attribute("aux", getAuxName(src.auxType));
+      bool isWrapped = (src.wrapped && withWrapped);
+      if (!isWrapped) {
+        J.attribute("arg", src.ixArg);
+      }
+      if (src.callsite) {
+        J.attributeArray("callsite", [&] {
+          DebugLoc dl = src.callsite->getDebugLoc();
+          // Filenames aren't necessarily UTF-8, which JSON requires.
+          StringRef filename = dl ? dl.get()->getFilename() : "???";
+          J.value(json::isUTF8(filename) ? filename.str() : json::fixUTF8(filename));
+          J.value(src.callsite->getFunction()->getName());
+          J.value(dl ? (int64_t)dl.getLine() : -1);
+          J.value(dl ? (int64_t)dl.getCol() : -1);
+        });
+        vector<string> stdFiles = stdFilesOf(src);
+        if (!stdFiles.empty()) {
+          J.attribute("FILE*", stdFiles.back());
+        }
+      } else {
+        J.attribute("callsite", nullptr);
+      }
+      if (isWrapped) {
+        J.attributeBegin("wrapped");
+        writeScrinkJson(J, *src.wrapped, false);
+        J.attributeEnd();
+      }
+    });
+  }
+
+  // Binary output (-output-format=binary), converted back to the text
+  // output by read_flows.py.  It holds what the text output does, but each
+  // string, callsite and scrink is stored once, in a table, and referred to
+  // by its index.  Every field is a little-endian uint32 at a 4-byte aligned
+  // offset, so the file can be mmap'ed.  After a header of the magic "DMCB",
+  // the version, and the (offset, count) of each section, the sections are:
+  //   string offsets: count+1 offsets into the string data
+  //   string data:    the strings, not terminated
+  //   callsites:      {file, function, line, column, callee}
+  //   scrinks:        {func, arg, aux, callsite, wrapped, aux_file, FILE* list}
+  //   functions:      {name, arg names list, records list}
+  //   records:        {kind, sink, sources list}, BIN_RECORD_*
+  //   refs:           the contents of the lists
+  //   unrecognized:   the unrecognized external functions
+  // A list is a (first, count) pair of indices into the refs; BIN_NONE
+  // stands for a missing string, callsite or scrink, and the file of a
+  // callsite without debug info.
+  #define BIN_MAGIC "DMCB"
+  #define BIN_VERSION 1
+  #define BIN_NONE UINT32_MAX
+  #define BIN_RECORD_RETURN 0     // return-value taint; sink is unused
+  #define BIN_RECORD_ARG 1        // taint of an argument; sink is its index
+  #define BIN_RECORD_PARAM_SINK 2 // the parameters reaching a sink
+  #define BIN_RECORD_FLOW 3       // the sources reaching a sink (FULL FLOWS)
+
+  struct BinaryTables {
+    vector<uint32_t> strOffsets = {0};
+    string strData;
+    StringMap<uint32_t> strIds;
+    DenseMap<CallBase*, uint32_t> callsiteIds;
+    map<SrcOrSink_t, uint32_t> scrinkIds;
+    vector<uint32_t> callsites, scrinks, functions, records, refs, unrecognized;
+  };
+
+  uint32_t binString(BinaryTables& T, StringRef str) {
+    auto [it, inserted] = T.strIds.try_emplace(str, T.strOffsets.size() - 1);
+    if (inserted) {
+      T.strData += str;
+      T.strOffsets.push_back(T.strData.size());
+    }
+    return it->second;
+  }
+
+  uint32_t binCallsite(BinaryTables& T, CallBase* callsite) {
+    if (callsite == nullptr) {
+      return BIN_NONE;
+    }
+    if (auto it = T.callsiteIds.find(callsite); it != T.callsiteIds.end()) {
+      return it->second;
+    }
+    DebugLoc dl = callsite->getDebugLoc();
+    Function* callee = callsite->getCalledFunction();
+    uint32_t id = T.callsites.size() / 5;
+    T.callsites.insert(T.callsites.end(), {
+      dl ? binString(T, dl.get()->getFilename()) : BIN_NONE,
+      binString(T, callsite->getFunction()->getName()),
+      dl ? dl.getLine() : BIN_NONE,
+      dl ? dl.getCol() : BIN_NONE,
+      callee ? binString(T, callee->getName()) : BIN_NONE});
+    T.callsiteIds[callsite] = id;
+    return id;
+  }
+
+  // Appends a list to the refs, as a (first, count) pair to 'out'.
+  void binList(BinaryTables& T, vector<uint32_t>& out, const vector<uint32_t>& items) {
+    out.push_back(T.refs.size());
+    out.push_back(items.size());
+    T.refs.insert(T.refs.end(), items.begin(), items.end());
+  }
+
+  uint32_t binScrink(BinaryTables& T, const SrcOrSink_t& src) {
+    if (auto it = T.scrinkIds.find(src); it != T.scrinkIds.end()) {
+      return it->second;
+    }
+    vector<uint32_t> fields = {
+      src.func ? binString(T, src.func->getName()) : BIN_NONE,
+      (uint32_t)src.ixArg,
+      (uint32_t)src.auxType,
+      binCallsite(T, src.callsite),
+      src.wrapped ? binScrink(T, *src.wrapped) : BIN_NONE,
+      src.auxConst ? binString(T, getStringFromConstantExpr(src.auxConst)) : BIN_NONE};
+    vector<uint32_t> stdFiles;
+    if (src.callsite) {
+      for (const string& sf : stdFilesOf(src)) {
+        stdFiles.push_back(binString(T, sf));
+      }
+    }
+    binList(T, fields, stdFiles);
+    uint32_t id = T.scrinks.size() / fields.size();
+    T.scrinks.insert(T.scrinks.end(), fields.begin(), fields.end());
+    T.scrinkIds[src] = id;
+    return id;
+  }
+
+  void binRecord(BinaryTables& T, uint32_t kind, uint32_t sink, const SensSrcSet_t& taints) {
+    vector<uint32_t> srcs;
+    for (const SensSrc_t& src : asSingleSet(taints)) {
+      srcs.push_back(binScrink(T, src));
+    }
+    T.records.push_back(kind);
+    T.records.push_back(sink);
+    binList(T, T.records, srcs);
+  }
+
+  void writeBinary(raw_ostream& os, Module& M) {
+    BinaryTables T;
+    for (Function &F : M) {
+      if (F.isDeclaration()) {continue;}
+      FuncSummary_t& summary = funcFlowsBySink[&F];
+      uint32_t firstRecord = T.records.size() / 4;
+      binRecord(T, BIN_RECORD_RETURN, BIN_NONE, summary.sourcesOf({&F, RETVAL_CODE, nullptr}));
+      vector<uint32_t> argNames;
+      int ixArg = -1;
+      for (auto &Arg : F.args()) {
+        ixArg++;
+        argNames.push_back(binString(T, Arg.getName()));
+        binRecord(T, BIN_RECORD_ARG, ixArg, summary.sourcesOf({&F, ixArg, nullptr}));
+      }
+      vector<Sink_t> sinks = sortedSinksOf(F);
+      for (const Sink_t& sink : sinks) {
+        if (sink.callsite == nullptr || sink.ixArg == RETVAL_CODE || sink.isPlaceholder()) {
+          continue;
+        }
+        SensSrcSet_t halfTaints;
+        for (const SensSrc_t& taint : summary.sourcesOf(sink)) {
+          if (taint.isSummaryScrink()) {
+            halfTaints.insert(taint);
+          }
+        }
+        if (!halfTaints.empty()) {
+          binRecord(T, BIN_RECORD_PARAM_SINK, binScrink(T, sink), halfTaints);
+        }
+      }
+      for (const Sink_t& sink : sinks) {
+        SensSrcSet_t fullTaints;
+        if (getFullTaints(F, sink, fullTaints)) {
+          binRecord(T, BIN_RECORD_FLOW, binScrink(T, sink), fullTaints);
+        }
+      }
+      T.functions.push_back(binString(T, F.getName()));
+      binList(T, T.functions, argNames);
+      T.functions.push_back(firstRecord);
+      T.functions.push_back(T.records.size() / 4 - firstRecord);
+    }
+    for (Function* func : unknownExtFuncs) {
+      T.unrecognized.push_back(binString(T, func->getName()));
+    }
 
+    // The string data is padded to keep the tables after it aligned.
+    uint32_t numStrings = T.strOffsets.size() - 1;
+    uint32_t dataSize = T.strData.size();
+    T.strData.resize(alignTo(dataSize, 4), '\0');
+    vector<pair<const vector<uint32_t>*, uint32_t>> tables = {
+      {&T.callsites, 5}, {&T.scrinks, 8}, {&T.functions, 5},
+      {&T.records, 4}, {&T.refs, 1}, {&T.unrecognized, 1}};
+    support::endian::Writer W(os, support::little);
+    os << BIN_MAGIC;
+    W.write<uint32_t>(BIN_VERSION);
+    uint32_t offset = 4 * (2 + 2 * (2 + tables.size()));
+    W.write<uint32_t>(offset);
+    W.write<uint32_t>(numStrings);
+    offset += 4 * T.strOffsets.size();
+    W.write<uint32_t>(offset);
+    W.write<uint32_t>(dataSize);
+    offset += T.strData.size();
+    for (auto [table, width] : tables) {
+      W.write<uint32_t>(offset);
+      W.write<uint32_t>(table->size() / width);
+      offset += 4 * table->size();
+    }
+    W.write<uint32_t>(T.strOffsets);
+    os << T.strData;
+    for (auto [table, width] : tables) {
+      W.write<uint32_t>(*table);
+    }
   }
 
-  void printFuncSummary(Function& F) {
-    outs() << "################## \n";
-    outs() << "# Function: " << F.getName() << "\n";
+  void printFuncSummary(raw_ostream& os, Function& F) {
+    os << "################## \n";
+    os << "# Function: " << F.getName() << "\n";
     // Print return-value taint.
     Sink_t retSink = {&F, RETVAL_CODE, nullptr};
-    SensSrcSet_t& retTaint = funcFlowsBySink[&F][retSink];
-    llvm::outs() << "\"Return\": [";
+    SensSrcSet_t& retTaint = funcFlowsBySink[&F].sourcesOf(retSink);
+    os << "\"Return\": [";
     for (const SensSrc_t& src : asSingleSet(retTaint)) {
-      dumpSrcOrSink(outs(), src, nullptr);
-      llvm::outs() << ", ";
+      dumpSrcOrSink(os, src, nullptr);
+      os << ", ";
     }
-    llvm::outs() << "]\n";
+    os << "]\n";
 
     // Print OUT-argument taints.
     {
       int ixArg = -1;
       for (auto &Arg : F.args()) {
         ixArg++;
-        llvm::outs() << "Arg " << ixArg << ": " << Arg.getName() << ": ";
+        os << "Arg " << ixArg << ": " << Arg.getName() << ": ";
         Sink_t argSink = {&F, ixArg, nullptr};
-        for (const SensSrc_t& src : asSingleSet(funcFlowsBySink[&F][argSink])) {
-          dumpSrcOrSink(outs(), src, nullptr);
-          llvm::outs() << ", ";
+        for (const SensSrc_t& src : asSingleSet(funcFlowsBySink[&F].sourcesOf(argSink))) {
+          dumpSrcOrSink(os, src, nullptr);
+          os << ", ";
         }
-        llvm::outs() << "\n";
+        os << "\n";
       }
     }
 
     // Print sink taints.
-    llvm::outs() << "\"Sinks\": [\n";
-    for (auto const& [sink, taints] : funcFlowsBySink[&F]) {
-      if (sink.callsite == nullptr || sink.ixArg == RETVAL_CODE) {
+    os << "\"Sinks\": [\n";
+    for (const Sink_t& sink : sortedSinksOf(F)) {
+      if (sink.callsite == nullptr || sink.ixArg == RETVAL_CODE || sink.isPlaceholder()) {
         continue;
       }
+      const SensSrcSet_t& taints = funcFlowsBySink[&F].sourcesOf(sink);
       SensSrcSet_t fullTaints;
       SensSrcSet_t halfTaints;
-      for (SensSrc_t taint : asSingleSet(taints)) {
+      for (const SensSrc_t& taint : taints) {
         if (!taint.isSummaryScrink()) {
           fullTaints.insert(taint);
         } else {
@@ -1282,73 +5157,265 @@ public:
       if (halfTaints.empty()) {
         continue;
       }
-      llvm::outs() << "  [";
-      write_file_line_col(sink.callsite);
-      llvm::outs() << ", \"" << sink.callsite->getCalledFunction()->getName() << " arg " << sink.ixArg << "\", [\n";
+      os << "  [";
+      write_file_line_col(sink.callsite, os);
+      os << ", \"" << sink.callsite->getCalledFunction()->getName() << " arg " << sink.ixArg << "\", [\n";
       for (const SensSrc_t& src : asSingleSet(halfTaints)) {
-        outs() << "    ";
-        dumpSrcOrSink(outs(), src, nullptr);
-        outs() << ",\n";
+        os << "    ";
+        dumpSrcOrSink(os, src, nullptr);
+        os << ",\n";
+      }
+      os << "  ]],\n";
+    }
+    os << "]\n";
+  }
+
+  // The concrete sources reaching a real sink in F, as printed in the FULL
+  // FLOWS; false if there are none.
+  bool getFullTaints(Function& F, const Sink_t& sink, SensSrcSet_t& fullTaints) {
+    if (sink.callsite == nullptr || sink.ixArg == RETVAL_CODE || sink.isPlaceholder() || !isQueriedSink(sink)) {
+      return false;
+    }
+    const SensSrcSet_t& taints = funcFlowsBySink[&F].sourcesOf(sink);
+    for (const SensSrc_t& taint : taints) {
+      if ((taint.auxConst && sink.auxType != AUX_TYPE_FILE) || taint.isPlaceholder()) {
+        continue;
+      }
+      if (!taint.isSummaryScrink()) {
+        fullTaints.insert(taint);
       }
-      llvm::outs() << "  ]],\n";
     }
-    llvm::outs() << "]\n";
+    return !fullTaints.empty();
   }
 
-  void printFuncTaints(Function& F) {
+  void printFuncTaints(raw_ostream& os, Function& F) {
     bool printedHeader = false;
     StringRef funcName = F.getName(); // for debugging
     (void)funcName;
     // Print full taints.
 
-    for (auto const& [sink, taints] : funcFlowsBySink[&F]) {
+    for (const Sink_t& sink : sortedSinksOf(F)) {
       // llvm::outs() << "Evaling " << funcName.data() << " for flow\n";
       // std::cout << "Evaling " << funcName.data() << " for flow" << std::endl;
-      if (sink.callsite == nullptr || sink.ixArg == RETVAL_CODE) {
-        continue;
-      }
-      auto callee_name = sink.callsite->getCalledFunction()->getName();
-      (void)callee_name;
-      if (sink.callsite->getArgOperand(sink.ixArg)) {
-        //continue;
-      }
       SensSrcSet_t fullTaints;
-      for (SensSrc_t taint : asSingleSet(taints)) {
-        if (taint.auxConst && sink.auxType != AUX_TYPE_FILE) {
-          continue;
-        }
-        if (!taint.isSummaryScrink()) {
-          fullTaints.insert(taint);
-        }
-      }
-      if (fullTaints.empty()) {
+      if (!getFullTaints(F, sink, fullTaints)) {
         continue;
       }
       if (!printedHeader) {
         printedHeader = true;
-        outs() << "################## \n";
-        outs() << "# Function: " << F.getName() << "\n";
-        llvm::outs() << "<flows>\n[\n";
+        os << "################## \n";
+        os << "# Function: " << F.getName() << "\n";
+        os << "<flows>\n[\n";
       }
-      llvm::outs() << "  {\"sink\": ";
+      os << "  {\"sink\": ";
       string sink_wrap_indent = "      "s;
-      dumpSrcOrSink(outs(), sink, &sink_wrap_indent);
-      llvm::outs() << ",\n   \"sources\": [\n";
+      dumpSrcOrSink(os, sink, &sink_wrap_indent);
+      os << ",\n   \"sources\": [\n";
       //write_file_line_col(sink.callsite);
       //llvm::outs() << ", \"" << sink.callsite->getCalledFunction()->getName() << " arg " << sink.ixArg << "\", [\n";
       for (const SensSrc_t& src : asSingleSet(fullTaints)) {
-        llvm::outs() << "    ";
+        os << "    ";
         string indent = "      ";
-        dumpSrcOrSink(outs(), src, &indent);
-        outs() << ",\n";
+        dumpSrcOrSink(os, src, &indent);
+        os << ",\n";
       }
-      llvm::outs() << "  ]},\n";
+      os << "  ]},\n";
     }
     if (!printedHeader) {
-      outs() << "Function " << F.getName() << ": no full flows.\n";
+      os << "Function " << F.getName() << ": no full flows.\n";
     } else {
-      llvm::outs() << "]\n</flows>\n";
+      os << "]\n</flows>\n";
+    }
+  }
+
+  // Connecting flows (-connect-flows) does what connect_flows.py does with
+  // the FULL FLOWS: each source of a flow into a main sink is followed by
+  // the sources of the flows into the auxiliary sinks of the same call
+  // (e.g., the name of the file that a FILE* passed to it was opened with),
+  // recursively.  Scrinks are compared by their rendering, as the script
+  // compares the parsed JSON; "link" keys leave out "arg" and "aux".
+  struct FlowObj {
+    const SrcOrSink_t* scrink;
+    bool nested; // rendered inside its wrapper, so without its own wrapped scrink
+  };
+
+  struct ConnectedFlows {
+    string baseDir;
+    // Flows in FULL FLOWS order; a deque, so FlowObjs can point into it.
+    std::deque<pair<SrcOrSink_t, vector<SrcOrSink_t>>> flows;
+    // Link key of an auxiliary sink -> its aux type -> its sources.
+    map<string, vector<pair<string, vector<FlowObj>>>> auxSources;
+    map<string, unsigned> ids;
+  };
+
+  string fullKey(FlowObj obj) {
+    string text;
+    raw_string_ostream os(text);
+    string indent = "      ";
+    dumpSrcOrSink(os, *obj.scrink, obj.nested ? nullptr : &indent);
+    return os.str();
+  }
+
+  string linkHead(FlowObj obj) {
+    const SrcOrSink_t& src = *obj.scrink;
+    if (src.auxConst) {
+      return "{aux_file:" + getStringFromConstantExpr(src.auxConst);
+    }
+    string text;
+    raw_string_ostream os(text);
+    os << "{" << (src.func ? src.func->getName() : "null") << "\x1f";
+    if (src.callsite) {
+      write_file_line_col(src.callsite, os);
+      vector<string> stdFiles = stdFilesOf(src);
+      if (!stdFiles.empty()) {
+        os << "\x1f" << stdFiles.back();
+      }
+    } else {
+      os << "null";
+    }
+    return os.str();
+  }
+
+  string linkKey(FlowObj obj) {
+    string key = linkHead(obj);
+    if (!obj.nested && obj.scrink->wrapped) {
+      key += "\x1e" + linkKey({obj.scrink->wrapped, true});
+    }
+    return key + "}";
+  }
+
+  unsigned connectedIdOf(ConnectedFlows& cf, const string& fullKey) {
+    return cf.ids.insert({fullKey, cf.ids.size() + 1}).first->second;
+  }
+
+  void dumpConnected(raw_ostream& os, ConnectedFlows& cf, FlowObj obj, unsigned indent,
+                     const FlowObj* wrapper, set<string>& seen) {
+    const SrcOrSink_t& src = *obj.scrink;
+    if (src.auxConst) {
+      os << "{\"filename\":\"" << getStringFromConstantExpr(src.auxConst) << "\"} ";
+      return;
+    }
+    string key = fullKey(obj);
+    if (!seen.insert(key).second) {
+      os << "{\"repeat\":" << connectedIdOf(cf, key) << "}";
+      return;
+    }
+    os << "{\"func\":\"" << (src.func ? src.func->getName() : "null") << "\", \"callsite\":";
+    if (src.callsite) {
+      write_file_line_col(src.callsite, os, cf.baseDir);
+    } else {
+      os << "null";
+    }
+    os << ", \"id\":" << connectedIdOf(cf, key);
+    if (src.callsite) {
+      vector<string> stdFiles = stdFilesOf(src);
+      if (!stdFiles.empty()) {
+        os << ", \"FILE*\":\"" << stdFiles.back() << "\"";
+      }
+    }
+    if (!obj.nested && src.wrapped) {
+      os << ",\n" << string(indent, ' ') << "\"wrapped\":";
+      dumpConnected(os, cf, {src.wrapped, true}, indent + 2, wrapper ? wrapper : &obj, seen);
+    }
+    vector<string> linkKeys = {linkKey(obj)};
+    if (wrapper) {
+      linkKeys.push_back(linkHead(*wrapper) + "\x1e" + linkKeys[0] + "}");
+    }
+    for (const string& link : linkKeys) {
+      auto itAux = cf.auxSources.find(link);
+      if (itAux == cf.auxSources.end()) {
+        continue;
+      }
+      for (auto& [auxType, sources] : itAux->second) {
+        os << ",\n" << string(indent, ' ') << "\"aux " << auxType << "\": [";
+        bool isFirst = true;
+        for (FlowObj auxSrc : sources) {
+          if (!isFirst) {
+            os << ",\n" << string(indent, ' ');
+          }
+          isFirst = false;
+          dumpConnected(os, cf, auxSrc, indent + 2, wrapper, seen);
+        }
+        os << "]";
+      }
+    }
+    os << "}";
+  }
+
+  void printConnectedFlows(raw_ostream& os, Module& M) {
+    ConnectedFlows cf;
+    cf.baseDir = FlowsBaseDir;
+    if (cf.baseDir != "" && cf.baseDir.back() != '/') {
+      cf.baseDir += "/";
+    }
+    for (Function &F : M) {
+      if (F.isDeclaration()) {continue;}
+      for (const Sink_t& sink : sortedSinksOf(F)) {
+        SensSrcSet_t fullTaints;
+        if (getFullTaints(F, sink, fullTaints)) {
+          set<SensSrc_t> sources = asSingleSet(fullTaints);
+          cf.flows.push_back({sink, vector<SrcOrSink_t>(sources.begin(), sources.end())});
+        }
+      }
+    }
+    // Sources of the auxiliary sinks, without duplicates.
+    map<pair<string, string>, set<string>> auxSeen;
+    for (auto& [sink, sources] : cf.flows) {
+      if (sink.auxType == AUX_TYPE_MAIN) {
+        continue;
+      }
+      string link = linkKey({&sink, false});
+      string auxType = getAuxName(sink.auxType);
+      auto& byAuxType = cf.auxSources[link];
+      auto itType = std::find_if(byAuxType.begin(), byAuxType.end(),
+                                 [&](auto& entry) { return entry.first == auxType; });
+      if (itType == byAuxType.end()) {
+        itType = byAuxType.insert(byAuxType.end(), {auxType, {}});
+      }
+      set<string>& seenSources = auxSeen[{link, auxType}];
+      for (const SrcOrSink_t& src : sources) {
+        if (seenSources.insert(fullKey({&src, false})).second) {
+          itType->second.push_back({&src, false});
+        }
+      }
+    }
+    os << "[\n";
+    bool isFirst = true;
+    set<string> seenFlows;
+    for (auto& [sink, sources] : cf.flows) {
+      if (sink.auxType != AUX_TYPE_MAIN) {
+        continue;
+      }
+      string flowKey = fullKey({&sink, false});
+      for (const SrcOrSink_t& src : sources) {
+        flowKey += "\x1d" + fullKey({&src, false});
+      }
+      if (!seenFlows.insert(flowKey).second) {
+        continue;
+      }
+      if (!isFirst) {
+        os << ",\n\n";
+      }
+      isFirst = false;
+      os << "{\"sink\": ";
+      set<string> seen;
+      dumpConnected(os, cf, {&sink, false}, 4, nullptr, seen);
+      os << ",\n \"srcs\": [";
+      bool isFirstSrc = true;
+      for (const SrcOrSink_t& src : sources) {
+        if (src.auxType != AUX_TYPE_MAIN) {
+          continue;
+        }
+        if (!isFirstSrc) {
+          os << ",\n  ";
+        }
+        isFirstSrc = false;
+        set<string> seenInSrc;
+        dumpConnected(os, cf, {&src, false}, 4, nullptr, seenInSrc);
+      }
+      os << "]}";
     }
+    os << "\n]\n";
   }
 
 
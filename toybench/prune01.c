@@ -0,0 +1,58 @@
+// clang-14 -Xclang -disable-O0-optnone -fno-discard-value-names -fno-inline-functions -ggdb -c -S -emit-llvm -O0 prune01.c
+
+// <legal>
+// DMC Tool
+// Copyright 2023 Carnegie Mellon University.
+// 
+// NO WARRANTY. THIS CARNEGIE MELLON UNIVERSITY AND SOFTWARE ENGINEERING INSTITUTE
+// MATERIAL IS FURNISHED ON AN "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO
+// WARRANTIES OF ANY KIND, EITHER EXPRESSED OR IMPLIED, AS TO ANY MATTER
+// INCLUDING, BUT NOT LIMITED TO, WARRANTY OF FITNESS FOR PURPOSE OR
+// MERCHANTABILITY, EXCLUSIVITY, OR RESULTS OBTAINED FROM USE OF THE MATERIAL.
+// CARNEGIE MELLON UNIVERSITY DOES NOT MAKE ANY WARRANTY OF ANY KIND WITH RESPECT
+// TO FREEDOM FROM PATENT, TRADEMARK, OR COPYRIGHT INFRINGEMENT.
+// 
+// Released under a MIT (SEI)-style license, please see License.txt or contact
+// permission@sei.cmu.edu for full terms.
+// 
+// [DISTRIBUTION STATEMENT A] This material has been approved for public release
+// and unlimited distribution.  Please see Copyright notice for non-US Government
+// use and distribution.
+// 
+// Carnegie Mellon (R) and CERT (R) are registered in the U.S. Patent and Trademark
+// Office by Carnegie Mellon University.
+// 
+// This Software includes and/or makes use of the following Third-Party Software
+// subject to its own license:
+// 1. Phasar
+//     (https://github.com/secure-software-engineering/phasar/blob/development/LICENSE.txt)
+//     Copyright 2017 - 2023 Philipp Schubert and others.  
+// 2. LLVM (https://github.com/llvm/llvm-project/blob/main/LICENSE.TXT) 
+//     Copyright 2003 - 2022 LLVM Team.
+// 
+// DM23-0532
+// </legal>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Checked with -demand-driven -taint-threads=4 (see check_toybench.py):
+// S can't be on a flow into a sink and is skipped, but it calls N, like M
+// does; analyzing N must not put S back in the worklist.
+
+char *N(char *p) {
+    return p;
+}
+
+void M(void) {
+    printf("%s", N(getenv("X")));
+}
+
+char *S(void) {
+    return N(getenv("X"));
+}
+
+int main(void) {
+    M();
+    return 0;
+}